@@ -0,0 +1,352 @@
+#ifndef AUTOMATA_H
+#define AUTOMATA_H
+
+// Tipos y funciones internas de libca, compartidas por el parser y el visor
+// Los programas que solo necesitan la API estable deben incluir libca.h.
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "libca.h"
+
+// Estados del modelo SEIRS por defecto; un modelo definido por el usuario usa los índices que siguen a V
+typedef enum {V, S, E, I, R} Estado;  // Añadimos el estado V para vacío
+
+#define MAX_ESTADOS CA_MAX_ESTADOS
+#define CUBETAS_VECINOS 9  // Filas de la tabla por estado: 0..8 vecinos contagiosos (más de 8 cuentan como 8)
+#define SIN_GUIA 0xFF      // Franja de la guía que corta un umbral: hay que comparar con los umbrales
+
+// Probabilidades de transición, compartidas por todas las células de la matriz
+typedef ca_parametros Parametros;
+
+// Resumen de una corrida de un barrido de parámetros
+typedef ca_resultado ResultadoBarrido;
+
+// Transición de un modelo, tal como se define (con letras)
+typedef ca_transicion Transicion;
+
+// Fila compilada de la tabla de transiciones: salidas de un estado con una cantidad dada de vecinos contagiosos
+// Un sorteo uniforme de 31 bits elige el estado siguiente: la guía resuelve directamente cada franja de 2^23
+// valores que cae entera en un tramo, y solo las franjas que cortan un umbral recorren los umbrales.
+typedef struct {
+    int salidas;                        // Cantidad de destinos posibles (0: la célula no cambia)
+    float probabilidad;                 // Probabilidad total de cambiar (la usa el motor por eventos)
+    unsigned int umbral[MAX_ESTADOS];   // Límite superior acumulado de cada tramo, sobre 2^31
+    unsigned char destino[MAX_ESTADOS];
+    unsigned char guia[256];            // Estado siguiente para cada franja, o SIN_GUIA
+} FilaTransicion;
+
+// Modelo compartimental de la matriz: sus estados, sus transiciones y la tabla compilada a partir de ellas
+typedef struct {
+    int cantidad_estados;          // Incluye V (estado 0)
+    char letras[MAX_ESTADOS];      // Letra de cada estado ('V' para el vacío)
+    Transicion *transiciones;
+    int cantidad_transiciones;
+    int contagioso;                // Estado de los vecinos que cuentan las transiciones vecinales (-1 si no hay)
+    unsigned char vecinal[MAX_ESTADOS];  // 1 si alguna salida del estado depende de los vecinos
+    FilaTransicion tabla[MAX_ESTADOS][CUBETAS_VECINOS];
+} Modelo;
+
+// Direcciones de los autómatas adyacentes: primero los cuatro bordes y después las cuatro esquinas
+enum {BORDE_ARRIBA, BORDE_ABAJO, BORDE_IZQUIERDA, BORDE_DERECHA,
+      ESQUINA_ARRIBA_IZQUIERDA, ESQUINA_ARRIBA_DERECHA, ESQUINA_ABAJO_IZQUIERDA, ESQUINA_ABAJO_DERECHA};
+
+// Estructura para representar el autómata
+// Los estados se guardan en planos de N*N bytes (por filas), en memoria o dentro del archivo de respaldo.
+// Cada autómata tiene su propio N; los bordes con autómatas de otra resolución se resuelven con tablas precalculadas.
+typedef struct Automata {
+    unsigned char *estados;    // Plano con el estado actual
+    unsigned char *siguiente;  // Plano donde se escribe el siguiente paso
+    int N;
+    int id;  // ID del autómata
+    int indice_x;  // Índice en la matriz
+    int indice_y;
+    int respaldado;  // 1 si los planos están dentro del archivo de respaldo
+    long long contadores[MAX_ESTADOS];  // Células en cada estado del modelo
+    int corridas_al_dia;  // 0 si hay que volver a armar todas sus corridas en el próximo conteo de grupos
+    unsigned long long *filas_cambiadas;  // Con corridas_al_dia, un bit por fila donde alguna célula entró o salió
+                                          // del estado contagioso desde el último conteo (solo se rearman esas)
+    long long desplazamiento;  // Índice global de la célula (0,0): células de los autómatas anteriores
+    // Vecindad con los autómatas adyacentes, calculada por calcular_bordes
+    struct Automata *adyacentes[8];  // Autómata en cada dirección (NULL si no existe o tiene otro ID)
+    int *desde[4];  // Para cada posición a lo largo de un borde, primera y última posición del borde vecino
+    int *hasta[4];  // que la tocan (ambas incluidas)
+} Automata;
+
+// Acceso al estado de la célula (x,y) de un autómata con índice de 64 bits
+#define ESTADO(automata, x, y) ((automata)->estados[(long long)(x) * (automata)->N + (y)])
+
+// Entrada del historial: un paso codificado como fotograma clave (estado completo) o como delta (solo cambios)
+// Clave: corridas (estado, largo) sobre todas las células. Delta: corridas (salto, largo, estado) de células cambiadas.
+// Todos los enteros se guardan como varint de 7 bits por byte.
+typedef struct {
+    int paso;
+    int es_clave;
+    unsigned char *datos;
+    size_t tam;
+} EntradaHistorial;
+
+// Historial de pasos de una matriz de autómatas
+typedef struct {
+    EntradaHistorial *entradas;
+    int cantidad;
+    int capacidad;
+    size_t bytes_desde_clave;  // Bytes de delta acumulados desde el último fotograma clave
+    size_t tam_ultima_clave;
+    size_t bytes_totales;
+    // Delta del paso en construcción
+    unsigned char *delta;
+    size_t tam_delta;
+    size_t capacidad_delta;
+    long long fin_corrida;     // Índice siguiente al último de la corrida abierta (-1 si no hay)
+    long long inicio_corrida;
+    unsigned char estado_corrida;
+    long long fin_anterior;    // Fin de la corrida anterior, para codificar saltos
+} Historial;
+
+#define MIN_BYTES_ENTRE_CLAVES 4096  // Un delta acumulado menor que esto nunca fuerza un fotograma clave
+
+// Serie de tiempo con los totales de cada estado (indexados por Estado) después de cada paso
+typedef struct {
+    int *pasos;
+    long long (*totales)[MAX_ESTADOS];
+    int con_grupos;          // 1 si también se registran los grupos de células contagiosas
+    long long *grupos;       // Cantidad de grupos y tamaño del mayor en cada paso (-1 si no se registraron)
+    long long *mayor_grupo;
+    int cantidad;
+    int capacidad;
+} SerieTiempo;
+
+// Corridas de células contagiosas de un autómata: tramos consecutivos de una fila, unidos con union-find
+// cuando se tocan (vecindad de Moore) con un tramo de la fila anterior. Las corridas unidas forman los componentes
+// del autómata; a través de los bordes solo se guardan los pares de componentes que se tocan (enlaces).
+typedef struct {
+    Automata *automata;
+    int N;         // Lado del autómata cuando se armaron (0 antes del primer conteo)
+    int *inicio;   // Columnas inicial y final de cada corrida, ordenadas por fila y columna
+    int *fin;
+    int *primera;  // Índice de la primera corrida de cada fila (N+1 valores)
+    int cantidad;
+    int capacidad;
+    int *inicio_anterior;   // Corridas del conteo anterior, de donde se copian las filas que no cambiaron
+    int *fin_anterior;
+    int *primera_anterior;
+    int capacidad_anterior;
+    int *padre;       // Union-find local sobre las corridas
+    int *componente;  // Componente de cada corrida (0..componentes-1)
+    int capacidad_union;
+    long long *tamano_componente;  // Células de cada componente (con la misma capacidad que padre)
+    int componentes;
+    int rearmada;  // 1 si se volvió a armar en el conteo actual (sus enlaces y los de sus vecinos caducan)
+    // Enlaces hacia abajo, la derecha y las esquinas de abajo: pares (componente propio, componente del vecino)
+    Automata *vecino_enlaces[8];  // Vecino con el que se calcularon en cada dirección
+    int *enlaces[8];
+    int cantidad_enlaces[8];
+    int capacidad_enlaces[8];
+} CorridasAutomata;
+
+// Autómatas a etiquetar en un conteo de grupos; cada hilo toma el siguiente pendiente hasta agotarlos
+typedef struct {
+    CorridasAutomata *corridas;
+    int *pendientes;  // Índices de los autómatas a etiquetar
+    int cantidad;
+    int siguiente;    // Próximo pendiente sin tomar (se avanza con una suma atómica)
+    unsigned char contagioso;
+} TrabajoGrupos;
+
+// Hilos que etiquetan los autómatas de cada conteo de grupos; se crean una vez y esperan entre rondas
+typedef struct {
+    pthread_t *hilos;
+    int cantidad_hilos;   // Sin contar el hilo que pide el conteo, que también etiqueta
+    pthread_mutex_t mutex;
+    pthread_cond_t inicio;  // Hay una ronda nueva
+    pthread_cond_t fin;     // Un hilo terminó su parte de la ronda
+    int ronda;
+    int trabajando;  // Hilos que todavía no terminaron la ronda actual
+    int salir;
+    pid_t pid;  // Proceso que creó los hilos (un hijo de fork no los tiene y etiqueta solo)
+    TrabajoGrupos trabajo;
+} HilosGrupos;
+
+// Grupos de células contagiosas conectadas, también a través de bordes entre autómatas con el mismo ID
+typedef struct {
+    long long grupos;
+    long long celulas;
+    long long mayor;
+    long long *tamanos;  // Tamaño de cada grupo (solo si se pidió; lo libera quien llama)
+} ResumenGrupos;
+
+// Conteo de grupos que se conserva entre pasos: corridas y enlaces de cada autómata, y el último resultado
+typedef struct {
+    CorridasAutomata *corridas;  // Una por autómata, en el orden de la matriz
+    int contagioso;              // Estado con el que se armaron (-1 si hay que armar todo)
+    long long *base;             // Primer componente de cada autómata en el union-find de la matriz
+    long long *padre;            // Union-find sobre los componentes de todos los autómatas
+    long long *tamano;           // Células de cada grupo, acumuladas en su raíz
+    long long capacidad;
+    ResumenGrupos resultado;     // Último conteo (sin tamanos)
+} ConteoGrupos;
+
+// Motores de simulación disponibles
+typedef enum {MOTOR_CUADRICULA, MOTOR_EVENTOS} Motor;
+
+// Cambio programado para un paso; aplicar recibe el dato y liberar lo descarta
+typedef struct Intervencion {
+    int paso;
+    void *dato;
+    void (*aplicar)(void *dato);
+    void (*liberar)(void *dato);
+    struct Intervencion *siguiente;
+} Intervencion;
+
+// Estructura para almacenar una matriz de autómatas (es el ca_mundo de la API pública)
+typedef struct ca_mundo MatrizAutomatas;
+struct ca_mundo {
+    Automata ***matriz;  // Cambiamos a matriz bidimensional para facilitar el acceso
+    int filas;
+    int columnas;
+    Motor motor;  // Motor usado por avanzar_simulacion
+    Parametros parametros;
+    Modelo modelo;
+    int modelo_al_dia;  // 0 si cambió el modelo o algún parámetro desde la última compilación de la tabla
+    int paso_actual;  // Pasos simulados desde que se creó la matriz
+    Historial *historial;  // NULL si el historial está desactivado
+    int historial_vencido; // 1 si cambió el tamaño de algún autómata y falta reiniciar el historial
+    Intervencion *intervenciones;  // Cambios programados, ordenados por paso
+    Intervencion *aplicadas;       // Cambios ya aplicados, ordenados por paso (ver reprogramar_intervenciones)
+    SerieTiempo *serie;  // NULL si la serie de tiempo está desactivada
+    int silencioso;  // 1 si el parser no muestra las cuadrículas de cada paso (la biblioteca no escribe nada)
+    unsigned char *respaldo;  // Proyección del archivo de respaldo (NULL si todo está en memoria)
+    size_t tam_respaldo;
+    int fd_respaldo;
+    size_t tam_plano_respaldo;  // Bytes reservados para cada plano en el archivo (límite al cambiar de tamaño)
+    int bordes_al_dia;  // 0 si cambió algún ID o tamaño desde el último calcular_bordes
+    int max_vecinos;    // Cota de vecinos de una célula (puede pasar de 8 junto a autómatas más finos)
+    Automata **vecinos; // Buffers de max_vecinos elementos para obtener_vecinos
+    int *vecinos_x;
+    int *vecinos_y;
+    struct MotorEventos *eventos;  // Estado del motor por eventos entre llamadas (NULL si hay que armarlo de nuevo)
+    long eventos_procesados;       // Transiciones hechas por el motor por eventos desde que se creó la matriz
+    ConteoGrupos *grupos;        // Conteo de grupos guardado entre pasos (NULL antes del primero)
+    HilosGrupos *hilos_grupos;   // NULL hasta el primer conteo de grupos
+};
+
+// Evento programado del motor por eventos
+typedef struct {
+    long long celula;  // Índice global de la célula
+    int generacion;    // Generación de la célula al programar el evento (si cambia, el evento caducó)
+    int paso;          // Paso en que ocurre la transición
+} Evento;
+
+// Cambio de estado resuelto por el motor por eventos
+typedef struct {
+    long long celula;
+    Estado estado;
+} Cambio;
+
+// Cubeta del calendario de eventos
+typedef struct {
+    Evento *eventos;
+    int cantidad;
+    int capacidad;
+} Cubeta;
+
+#define TAM_CALENDARIO 4096  // Cantidad de cubetas del calendario (los pasos se asignan módulo este valor)
+
+// Estado del motor por eventos, guardado en la matriz entre llamadas a avanzar_simulacion_eventos
+typedef struct MotorEventos {
+    MatrizAutomatas *matriz;
+    Cubeta cubetas[TAM_CALENDARIO];  // Los eventos guardan el paso absoluto en que ocurren
+    int *vecinos_contagiosos;  // Vecinos en el estado contagioso de cada célula, mantenido incrementalmente
+    int *generacion;
+    long long totales[MAX_ESTADOS];  // Totales por estado de toda la matriz
+} MotorEventos;
+
+// Funciones
+void inicializar_grid(Automata *automata);
+void inicializar_parametros(Parametros *parametros);
+float* parametro_por_indice(Parametros *parametros, int parametro);
+int conserva_estados(const Modelo *modelo, const char *letras);
+int definir_modelo(MatrizAutomatas *matriz, const char *letras, const Transicion *transiciones, int cantidad);
+void compilar_modelo(MatrizAutomatas *matriz);
+int estado_por_letra(const Modelo *modelo, char letra);
+const FilaTransicion* fila_transicion(const Modelo *modelo, int estado, int contagiosos);
+unsigned char sortear_transicion(const FilaTransicion *fila, unsigned char estado, unsigned int sorteo);
+int obtener_id(Automata *automata);
+void establecer_id(Automata *automata, int id);
+void cambiar_id(MatrizAutomatas *matriz, int m, int n, int id);
+int cambiar_tamano(MatrizAutomatas *matriz, int m, int n, int N);
+void calcular_desplazamientos(MatrizAutomatas *matriz);
+void calcular_bordes(MatrizAutomatas *matriz);
+int obtener_vecinos(MatrizAutomatas *matriz, Automata *automata, int x_celula, int y_celula, Automata **automatas_vecinos, int *xs, int *ys);
+int contar_vecinos_contagiosos(MatrizAutomatas *matriz, Automata *automata, int x_celula, int y_celula);
+void simular_paso_automata(MatrizAutomatas *matriz, Automata *automata);
+void agregar_area(Automata *automata, Estado estado, int inicio_fila, int inicio_columna, int filas, int columnas);
+void agregar_area_matriz(MatrizAutomatas *matriz, int m, int n, Estado estado, int inicio_fila, int inicio_columna, int filas, int columnas);
+void contar_plano(const unsigned char *plano, int N, long long contadores[MAX_ESTADOS]);
+void contar_estados(Automata *automata);
+Automata* crear_automata(int id, int N, int indice_x, int indice_y);
+Automata* crear_automata_respaldado(int id, int N, int indice_x, int indice_y, unsigned char *estados, unsigned char *siguiente);
+void liberar_automata(Automata *automata);
+MatrizAutomatas* crear_matriz_automatas(int filas, int columnas, int N);
+MatrizAutomatas* crear_matriz_automatas_respaldada(int filas, int columnas, int N, const char *ruta, int paginas_grandes);
+void anticipar_automata(MatrizAutomatas *matriz, int fila, int columna);
+void liberar_matriz_automatas(MatrizAutomatas *matriz);
+void preparar_simulacion(MatrizAutomatas *matriz);
+void avanzar_simulacion(MatrizAutomatas *matriz, int tiempo);
+unsigned char* celula_por_indice(MatrizAutomatas *matriz, long long indice, Automata **automata, int *x, int *y);
+long long indice_celula(MatrizAutomatas *matriz, Automata *automata, int x, int y);
+float probabilidad_transicion(Modelo *modelo, Estado estado, int contagiosos);
+double muestrear_espera(float probabilidad);
+void agregar_evento(MotorEventos *motor, Evento evento);
+void programar_celula(MotorEventos *motor, long long indice, int paso_actual);
+Estado resolver_transicion(Modelo *modelo, Estado estado, int contagiosos);
+void propagar_cambio_contagioso(MotorEventos *motor, long long indice, int delta, int paso_actual);
+int comparar_cambios(const void *a, const void *b);
+MotorEventos* crear_motor_eventos(MatrizAutomatas *matriz);
+void descartar_motor_eventos(MatrizAutomatas *matriz);
+void avanzar_simulacion_eventos(MatrizAutomatas *matriz, int tiempo);
+long long total_celulas(MatrizAutomatas *matriz);
+void escribir_byte(Historial *historial, unsigned char byte);
+void escribir_varint(Historial *historial, unsigned long long valor);
+unsigned long long leer_varint(unsigned char **datos);
+void cerrar_corrida(Historial *historial);
+void agregar_entrada_historial(Historial *historial, int paso, int es_clave);
+Historial* crear_historial(MatrizAutomatas *matriz);
+void liberar_historial(Historial *historial);
+int reiniciar_historial(MatrizAutomatas *matriz);
+void historial_registrar(Historial *historial, long long indice, Estado estado);
+void historial_cerrar_paso(MatrizAutomatas *matriz);
+void historial_registrar_area(MatrizAutomatas *matriz, Automata *automata, int inicio_fila, int inicio_columna, int filas, int columnas);
+void historial_agregar_clave(MatrizAutomatas *matriz);
+void aplicar_entrada_historial(EntradaHistorial *entrada, unsigned char *planos);
+unsigned char* reconstruir_paso(MatrizAutomatas *matriz, int paso, int *siguiente_entrada);
+int ir_a_paso(MatrizAutomatas *matriz, int paso);
+
+void programar_intervencion(MatrizAutomatas *matriz, int paso, void *dato, void (*aplicar)(void *dato), void (*liberar)(void *dato));
+void encolar_intervencion(MatrizAutomatas *matriz, Intervencion *intervencion);
+void aplicar_intervenciones(MatrizAutomatas *matriz);
+int reprogramar_intervenciones(MatrizAutomatas *matriz, int paso);
+void liberar_intervenciones(MatrizAutomatas *matriz);
+void contar_totales(MatrizAutomatas *matriz, long long totales[MAX_ESTADOS]);
+void registrar_serie(MatrizAutomatas *matriz, long long totales[MAX_ESTADOS]);
+void liberar_serie(SerieTiempo *serie);
+int buscar_bit(const unsigned long long *fila, int N, int desde, int valor);
+void etiquetar_corridas(CorridasAutomata *corridas, unsigned char contagioso);
+void* etiquetar_en_hilo(void *argumento);
+HilosGrupos* crear_hilos_grupos(int cantidad_hilos);
+void liberar_hilos_grupos(HilosGrupos *hilos);
+void etiquetar_con_hilos(HilosGrupos *hilos, TrabajoGrupos trabajo);
+void liberar_conteo_grupos(MatrizAutomatas *matriz);
+int corrida_en(const CorridasAutomata *corridas, int fila, int columna);
+long long raiz_grupo(long long *padre, long long corrida);
+void unir_grupos(long long *padre, long long a, long long b);
+void enlazar_borde_abajo(CorridasAutomata *arriba, CorridasAutomata *abajo);
+void enlazar_borde_derecha(CorridasAutomata *izquierda, CorridasAutomata *derecha);
+void enlazar_vecinos(MatrizAutomatas *matriz, CorridasAutomata *corridas, int k);
+void contar_grupos(MatrizAutomatas *matriz, ResumenGrupos *resumen, int con_tamanos);
+void correr_combinacion(MatrizAutomatas *matriz, const Parametros *parametros, int pasos, unsigned int semilla, int fd);
+int leer_resultado(int fd, ResultadoBarrido *resultado);
+int barrer_parametros(MatrizAutomatas *matriz, const Parametros *combinaciones, int cantidad, int pasos, int procesos, ResultadoBarrido *resultados);
+
+#endif
@@ -1,92 +1,250 @@
+%code requires {
+    #include "automata.h"
+}
+
+%union
+{
+    int ival;
+    char *str;
+    double real;
+    Transicion transicion;
+    struct Comando *comando;
+    struct Barrido *barrido;
+    struct DefinicionModelo *modelo;
+}
+
 %{
     #include <stdio.h>
     #include <stdlib.h>
     #include <string.h>
     #include <time.h>
+    #include <math.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #ifdef __linux__
+    #include <poll.h>
+    #include <pthread.h>
+    #include <sys/epoll.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #endif
 
-    // Estados posibles
-    typedef enum {V, S, E, I, R} Estado;  // Añadimos el estado V para vacío
+    // Tipos de comando del lenguaje
+    typedef enum {
+        CMD_CREAR, CMD_ID, CMD_AREA, CMD_RECORRER, CMD_PROGRAMAR, CMD_MOTOR, CMD_HISTORIAL, CMD_IR_A_PASO,
+        CMD_REPETIR_DESDE, CMD_MOSTRAR_IDS, CMD_MOSTRAR_CUADRICULAS, CMD_MOSTRAR_PASO, CMD_MOSTRAR_HISTORIAL,
+        CMD_SIMULAR, CMD_LIBERAR, CMD_REPETIR, CMD_SERIE, CMD_SALIDA, CMD_MOSTRAR_CONTADORES, CMD_MOSTRAR_SERIE,
+        CMD_MOSTRAR_INSTANTANEA, CMD_BARRIDO, CMD_TAMANO, CMD_MODELO, CMD_MOSTRAR_MODELO,
+        CMD_SERIE_GRUPOS, CMD_MOSTRAR_GRUPOS
+    } TipoComando;
 
-    // Estructura para representar una célula
-    typedef struct {
-        Estado estado;
-        float prob_infeccion;
-        float prob_exposicion;
-        float prob_recuperacion;
-        float prob_mortalidad;
-        float prob_perdida_inmunidad;  // Nueva probabilidad para la pérdida de inmunidad
-    } Celula;
-
-    // Estructura para representar el autómata
+    // Valores de cada parámetro de un SWEEP, indexados como en parametro_barrido (sin valores se usa el de la matriz)
+    typedef struct Barrido {
+        double *valores[5];
+        int cantidad[5];
+        int parametro;  // Parámetro al que se agregan los valores que siguen
+        int error;      // 1 si algún rango quedó mal escrito
+    } Barrido;
+
+    // Estados y transiciones de un DEFINE MODEL, tal como se escribieron (definir_modelo los valida)
+    typedef struct DefinicionModelo {
+        char *letras;
+        int cantidad_letras;
+        Transicion *transiciones;
+        int cantidad;
+    } DefinicionModelo;
+
+    // Comando ya analizado, listo para ejecutarse una o varias veces
+    typedef struct Comando {
+        TipoComando tipo;
+        int args[6];               // Argumentos numéricos, según el tipo (ver ejecutar_comando)
+        char letra;                // Letra del estado de un área
+        char *texto;
+        struct Comando *cuerpo;    // Comandos de un REPEAT, cambio de un AT STEP o comando de un FOR
+        Barrido *barrido;          // Valores de un SWEEP
+        DefinicionModelo *modelo;  // Estados y transiciones de un DEFINE MODEL
+        struct Comando *siguiente;
+    } Comando;
+
+    // Buffer de bytes para armar tramas
     typedef struct {
-        Celula **grid;
-        int N;
-        int id;  // ID del autómata
-        int indice_x;  // Índice en la matriz
-        int indice_y;
-        int contador_S;
-        int contador_E;
-        int contador_I;
-        int contador_R;
-        int contador_V;
-    } Automata;
-
-    // Estructura para almacenar una matriz de autómatas
+        unsigned char *datos;
+        size_t tam;
+        size_t capacidad;
+    } Buffer;
+
+    // Tipos de trama del modo servidor
+    typedef enum {TRAMA_FIN, TRAMA_TEXTO, TRAMA_CONTADORES, TRAMA_SERIE, TRAMA_CUADRICULA, TRAMA_ERROR} TipoTrama;
+
+    #define MAX_LOTE (1 << 20)       // Bytes que puede acumular un lote sin terminar antes de cerrar la conexión
+    #define ESPERA_ENVIO_MS 10000    // Tiempo que se espera a un cliente que no lee antes de desconectarlo
+    #define MAX_PENDIENTE (4 << 20)  // Bytes encolados de una sesión por encima de los cuales se deja de leer su socket
+
+    // Conexión de un cliente del modo servidor, con su propia matriz de autómatas
     typedef struct {
-        Automata ***matriz;  // Cambiamos a matriz bidimensional para facilitar el acceso
-        int filas;
-        int columnas;
-    } MatrizAutomatas;
+        int fd;
+        MatrizAutomatas *matriz;
+        char *entrada;  // Bytes recibidos que aún no forman un lote completo
+        size_t tam_entrada;
+        size_t capacidad_entrada;
+        size_t revisado;         // Bytes de entrada ya recorridos por despachar_entrada
+        size_t corte;            // Fin del último salto de línea fuera de llaves encontrado (0 si no hay)
+        int profundidad;         // Llaves abiertas hasta revisado
+        int profundidad_corte;   // Llaves abiertas hasta corte
+        int caida;               // 1 si ya no se le envía nada al cliente (solo la usa el trabajador)
+        int descartando;         // 1 si el lote superó MAX_LOTE: se descarta lo que llegue hasta que el cliente cierre
+        size_t pendiente;        // Bytes de lotes encolados que el trabajador aún no termina (con mutex_trabajos)
+        int pausada;             // 1 si se sacó el socket de epoll porque pendiente superó MAX_PENDIENTE (con mutex_trabajos)
+    } Sesion;
 
+    // Lote de comandos pendiente para el hilo trabajador (texto NULL indica que la sesión se cerró)
+    typedef struct Trabajo {
+        Sesion *sesion;
+        char *texto;
+        const char *error;  // Si no es NULL, en lugar de un lote se responde este error y se deja de enviar
+        size_t tam;         // Lo que el lote suma a sesion->pendiente
+        struct Trabajo *siguiente;
+    } Trabajo;
+
+    FILE *salida;  // Destino de todos los mensajes (stdout, o el texto de la respuesta en modo servidor)
     MatrizAutomatas *matriz_automatas;
+    Sesion *sesion_actual = NULL;  // Sesión cuyo lote se está ejecutando (NULL fuera del modo servidor)
+    char *texto_salida;
+    size_t tam_texto_salida;
+    #ifdef __linux__
+    pthread_mutex_t mutex_trabajos = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t hay_trabajo = PTHREAD_COND_INITIALIZER;
+    Trabajo *primer_trabajo = NULL;
+    Trabajo *ultimo_trabajo = NULL;
+    int epoll_servidor = -1;
+    #endif
+
+    // Funciones del analizador léxico usadas por el modo servidor
+    typedef struct yy_buffer_state *YY_BUFFER_STATE;
+    YY_BUFFER_STATE yy_scan_string(const char *texto);
+    void yy_delete_buffer(YY_BUFFER_STATE buffer);
 
     // Funciones
+    Comando* nuevo_comando(TipoComando tipo);
+    Comando* invertir_comandos(Comando *lista);
+    Comando* clonar_comando(Comando *comando);
+    void liberar_comando(Comando *comando);
+    void ejecutar_intervencion(void *dato);
+    void liberar_intervencion(void *dato);
+    int validar_automata(int m, int n);
+    void ejecutar_comando(Comando *comando, int verboso);
+    Barrido* nuevo_barrido(void);
+    void agregar_valor_barrido(Barrido *barrido, int parametro, double valor);
+    void agregar_rango_barrido(Barrido *barrido, double fin, double incremento);
+    Barrido* clonar_barrido(Barrido *barrido);
+    void liberar_barrido(Barrido *barrido);
+    void ejecutar_barrido(MatrizAutomatas *matriz, Barrido *barrido, int pasos, int procesos);
+    DefinicionModelo* nueva_definicion(void);
+    void agregar_estado_definicion(DefinicionModelo *definicion, char letra);
+    void agregar_transicion_definicion(DefinicionModelo *definicion, Transicion transicion);
+    DefinicionModelo* clonar_definicion(DefinicionModelo *definicion);
+    void liberar_definicion(DefinicionModelo *definicion);
+    void ejecutar_modelo(MatrizAutomatas *matriz, DefinicionModelo *definicion);
+    void simular_mostrando(MatrizAutomatas *matriz, int pasos);
     void mostrar_cuadriculas_automatas(MatrizAutomatas *matriz);
-    void inicializar_grid(Automata *automata);
-    int obtener_id(Automata *automata);
-    void establecer_id(Automata *automata, int id);
-    int contar_vecinos_infectados(MatrizAutomatas *matriz, Automata *automata, int x_celula, int y_celula);
-    void simular_paso_automata(MatrizAutomatas *matriz, Automata *automata, Automata *nuevo_automata);
-    void agregar_area(Automata *automata, Estado estado, int inicio_fila, int inicio_columna, int filas, int columnas);
-    void contar_estados(Automata *automata);
-    void mostrar_grid(Automata *automata);
+    void mostrar_modelo(MatrizAutomatas *matriz);
+    void mostrar_contadores_estados(const Modelo *modelo, const long long *contadores);
+    void mostrar_plano(MatrizAutomatas *matriz, const unsigned char *plano, int N);
+    void mostrar_grid(MatrizAutomatas *matriz, Automata *automata);
     void mostrar_matriz_automatas(MatrizAutomatas *matriz);
     void mostrar_matriz_ids(MatrizAutomatas *matriz);
-    Automata* crear_automata(int id, int N, int indice_x, int indice_y);
-    void liberar_automata(Automata *automata);
-    MatrizAutomatas* crear_matriz_automatas(int filas, int columnas, int N);
-    void liberar_matriz_automatas(MatrizAutomatas *matriz);
-    void avanzar_simulacion(MatrizAutomatas *matriz, int tiempo);
+    void mostrar_planos(MatrizAutomatas *matriz, const unsigned char *planos);
+    void mostrar_paso(MatrizAutomatas *matriz, int paso);
+    void repetir_desde_paso(MatrizAutomatas *matriz, int paso);
+    void mostrar_historial(MatrizAutomatas *matriz);
+    void mostrar_grupos(MatrizAutomatas *matriz);
+
+    void buffer_agregar(Buffer *buffer, const void *datos, size_t tam);
+    void buffer_u32(Buffer *buffer, unsigned int valor);
+    void buffer_u64(Buffer *buffer, unsigned long long valor);
+    void buffer_contadores(Buffer *buffer, const Modelo *modelo, const long long *contadores);
+    void buffer_contadores_extra(Buffer *buffer, const Modelo *modelo, const long long *contadores);
+    void enviar_trama(int tipo, const unsigned char *datos, size_t tam);
+    void vaciar_texto(void);
+    void terminar_respuesta(int estado);
+    void mostrar_contadores(MatrizAutomatas *matriz);
+    void mostrar_serie(MatrizAutomatas *matriz);
+    void mostrar_instantanea(MatrizAutomatas *matriz);
+    int servir(const char *direccion);
 
     int yylex();
     void yyerror(const char *s);
 %}
 
-%union
-{
-    int ival;
-    char *str;
-}
+%token RELEASE MEMORY CREATE GRID GRIDS ID M N SET AREA CELLS ALL ROWS IROW COLUMNS ICOLUMN PRINT SIMULATION MAKE STEP ENGINE EVENTS BACKING HUGEPAGES
+%token HISTORY ON OFF GOTO AT REPLAY FROM FOR REPEAT RANGE SERIES OUTPUT QUIET VERBOSE COUNTERS SNAPSHOT SWEEP WORKERS SIZE CLUSTERS
+%token DEFINE MODEL STATES RATE IF PER ARROW ENDLINE
+%token<ival> NUMBER PARAM STATE
+%token<real> FLOAT
+%token<str> STRING
+%type<comando> comando create grid set cambio area print history make release sweep modelo bloque
+%type<barrido> barrido
+%type<modelo> definicion estados
+%type<transicion> transicion tasa
+%type<real> valor
 
-%token RELEASE MEMORY CREATE GRID GRIDS ID M N SET AREA CELLS ALL ROWS IROW COLUMNS ICOLUMN PRINT SIMULATION MAKE STEP ENDLINE
-%token<ival> NUMBER
-%token<str> STATE
+%destructor { liberar_comando($$); } <comando>
+%destructor { free($$); } <str>
+%destructor { liberar_barrido($$); } <barrido>
+%destructor { liberar_definicion($$); } <modelo>
 
 %%
 input:
-    | input create
-    | input set
-    | input make
-    | input print
+    | input comando
+    {
+        ejecutar_comando($2, 1);
+        liberar_comando($2);
+        terminar_respuesta(0);
+    }
     | input ENDLINE
-    | input release
+    | input error ENDLINE
+    // Descartar la línea con error y seguir con la siguiente
+    {
+        yyerrok;
+        terminar_respuesta(1);
+    }
+;
+
+comando:
+    create
+    | set
+    | make
+    | print
+    | release
+    | history
+    | sweep
+    | modelo
+    | REPEAT NUMBER '{' bloque '}' ENDLINE
+    // Repetir NUMBER veces los comandos del bloque (uno por línea)
+    {
+        $$ = nuevo_comando(CMD_REPETIR);
+        $$->args[0] = $2;
+        $$->cuerpo = invertir_comandos($4);
+    }
+;
+
+bloque:
+    { $$ = NULL; }
+    | bloque ENDLINE { $$ = $1; }
+    | bloque comando
+    {
+        // Se arma al revés para no recorrer la lista en cada comando; REPEAT la invierte al final
+        $2->siguiente = $1;
+        $$ = $2;
+    }
 ;
 
 release:
     RELEASE MEMORY ENDLINE
     {
-        liberar_matriz_automatas(matriz_automatas);
-        printf("\nMemoria liberada con éxito.\n");
+        $$ = nuevo_comando(CMD_LIBERAR);
     }
 ;
 
@@ -99,387 +257,1555 @@ grid:
     CREATE GRID ROWS NUMBER COLUMNS NUMBER CELLS NUMBER ENDLINE
     // Crear una matriz de ROWxCOLUMNS autómatas, cada autómata de tamaño CELLSxCELLs células
     {
-        matriz_automatas = crear_matriz_automatas($4, $6, $8);
-        printf("\nAutómata celular asimétrico creado con éxito.\n");
+        $$ = nuevo_comando(CMD_CREAR);
+        $$->args[0] = $4;
+        $$->args[1] = $6;
+        $$->args[2] = $8;
+    }
+    |
+    CREATE GRID ROWS NUMBER COLUMNS NUMBER CELLS NUMBER BACKING STRING ENDLINE
+    // Igual que el anterior, pero los planos de estados quedan en el archivo STRING proyectado en memoria
+    // (el archivo se crea; si ya existe debe estar vacío)
+    {
+        $$ = nuevo_comando(CMD_CREAR);
+        $$->args[0] = $4;
+        $$->args[1] = $6;
+        $$->args[2] = $8;
+        $$->texto = $10;
+    }
+    |
+    CREATE GRID ROWS NUMBER COLUMNS NUMBER CELLS NUMBER BACKING STRING HUGEPAGES ENDLINE
+    {
+        $$ = nuevo_comando(CMD_CREAR);
+        $$->args[0] = $4;
+        $$->args[1] = $6;
+        $$->args[2] = $8;
+        $$->args[3] = 1;
+        $$->texto = $10;
     }
 ;
 
 set:
+    cambio ENDLINE
+    |
+    AT STEP NUMBER cambio ENDLINE
+    // Programar el cambio para cuando la simulación llegue al paso NUMBER
+    {
+        $$ = nuevo_comando(CMD_PROGRAMAR);
+        $$->args[0] = $3;
+        $$->cuerpo = $4;
+    }
+    |
+    SET ENGINE EVENTS ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOTOR);
+        $$->args[0] = MOTOR_EVENTOS;
+    }
+    |
+    SET ENGINE GRID ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOTOR);
+        $$->args[0] = MOTOR_CUADRICULA;
+    }
+    |
+    SET SERIES ON ENDLINE
+    {
+        $$ = nuevo_comando(CMD_SERIE);
+        $$->args[0] = 1;
+    }
+    |
+    SET SERIES OFF ENDLINE
+    {
+        $$ = nuevo_comando(CMD_SERIE);
+        $$->args[0] = 0;
+    }
+    |
+    SET SERIES CLUSTERS ON ENDLINE
+    // Registrar también los grupos de células contagiosas en cada paso de la serie
+    {
+        $$ = nuevo_comando(CMD_SERIE_GRUPOS);
+        $$->args[0] = 1;
+    }
+    |
+    SET SERIES CLUSTERS OFF ENDLINE
+    {
+        $$ = nuevo_comando(CMD_SERIE_GRUPOS);
+        $$->args[0] = 0;
+    }
+    |
+    SET OUTPUT QUIET ENDLINE
+    // No mostrar las cuadrículas de cada paso ni los resultados de MAKE SIMULATION
+    {
+        $$ = nuevo_comando(CMD_SALIDA);
+        $$->args[0] = 1;
+    }
+    |
+    SET OUTPUT VERBOSE ENDLINE
+    {
+        $$ = nuevo_comando(CMD_SALIDA);
+        $$->args[0] = 0;
+    }
+;
+
+cambio:
     //M = largo de la matriz
     //N = ancho de la matriz
-    SET ID NUMBER M NUMBER N NUMBER ENDLINE
+    SET ID NUMBER M NUMBER N NUMBER
     {
-        establecer_id(matriz_automatas->matriz[$5][$7], $3);
-        printf("\nID del autómata (%d,%d) establecido como %d.\n", $5, $7, $3);
+        $$ = nuevo_comando(CMD_ID);
+        $$->args[0] = $5;
+        $$->args[1] = $7;
+        $$->args[2] = $3;
     }
     |
-    SET AREA M NUMBER N NUMBER STATE IROW NUMBER ICOLUMN NUMBER ROWS NUMBER COLUMNS NUMBER ENDLINE
-    {
-        Estado state_new;
-        if (strcmp("S",$7) == 0){
-            state_new = S;
-        }else if (strcmp("I",$7) == 0){
-            state_new = I;
-        }else if (strcmp("R",$7) == 0){
-            state_new = R;
-        }else if (strcmp("E",$7) == 0){
-            state_new = E;
-        }
-        agregar_area(matriz_automatas->matriz[$4][$6], state_new, $9, $11, $13, $15);
-        printf("\nÁrea de %dx%d celdas con estado %s agregada al autómata (%d,%d).\n", $13, $15, $7, $4, $6);
-    } 
+    SET SIZE M NUMBER N NUMBER CELLS NUMBER
+    // Cambiar la cantidad de células por lado del autómata (m,n)
+    {
+        $$ = nuevo_comando(CMD_TAMANO);
+        $$->args[0] = $4;
+        $$->args[1] = $6;
+        $$->args[2] = $8;
+    }
+    |
+    SET AREA M NUMBER N NUMBER area
+    {
+        $$ = $7;
+        $$->args[0] = $4;
+        $$->args[1] = $6;
+    }
+    |
+    SET AREA ALL area
+    // Aplicar el área en todos los autómatas de la matriz
+    {
+        $$ = nuevo_comando(CMD_RECORRER);
+        $$->args[4] = 1;
+        $$->cuerpo = $4;
+    }
+    |
+    FOR M NUMBER RANGE NUMBER N NUMBER RANGE NUMBER SET ID NUMBER
+    // Establecer el mismo ID en todos los autómatas del rango (ambos extremos incluidos)
+    {
+        $$ = nuevo_comando(CMD_RECORRER);
+        $$->args[0] = $3;
+        $$->args[1] = $5;
+        $$->args[2] = $7;
+        $$->args[3] = $9;
+        $$->cuerpo = nuevo_comando(CMD_ID);
+        $$->cuerpo->args[2] = $12;
+    }
+    |
+    FOR M NUMBER RANGE NUMBER N NUMBER RANGE NUMBER SET SIZE CELLS NUMBER
+    {
+        $$ = nuevo_comando(CMD_RECORRER);
+        $$->args[0] = $3;
+        $$->args[1] = $5;
+        $$->args[2] = $7;
+        $$->args[3] = $9;
+        $$->cuerpo = nuevo_comando(CMD_TAMANO);
+        $$->cuerpo->args[2] = $13;
+    }
+    |
+    FOR M NUMBER RANGE NUMBER N NUMBER RANGE NUMBER SET AREA area
+    {
+        $$ = nuevo_comando(CMD_RECORRER);
+        $$->args[0] = $3;
+        $$->args[1] = $5;
+        $$->args[2] = $7;
+        $$->args[3] = $9;
+        $$->cuerpo = $12;
+    }
+;
+
+area:
+    STATE IROW NUMBER ICOLUMN NUMBER ROWS NUMBER COLUMNS NUMBER
+    {
+        $$ = nuevo_comando(CMD_AREA);
+        $$->letra = $1;
+        $$->args[2] = $3;
+        $$->args[3] = $5;
+        $$->args[4] = $7;
+        $$->args[5] = $9;
+    }
 ;
 
 print: 
     PRINT ALL ID ENDLINE
     {
-        mostrar_matriz_ids(matriz_automatas);
+        $$ = nuevo_comando(CMD_MOSTRAR_IDS);
     }
     | PRINT GRIDS ENDLINE
     {
-       mostrar_cuadriculas_automatas(matriz_automatas);
+        $$ = nuevo_comando(CMD_MOSTRAR_CUADRICULAS);
+    }
+    | PRINT GRIDS AT STEP NUMBER ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_PASO);
+        $$->args[0] = $5;
+    }
+    | PRINT HISTORY ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_HISTORIAL);
+    }
+    | PRINT COUNTERS ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_CONTADORES);
+    }
+    | PRINT SERIES ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_SERIE);
+    }
+    | PRINT SNAPSHOT ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_INSTANTANEA);
+    }
+    | PRINT MODEL ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_MODELO);
+    }
+    | PRINT CLUSTERS ENDLINE
+    {
+        $$ = nuevo_comando(CMD_MOSTRAR_GRUPOS);
+    }
+;
+
+history:
+    SET HISTORY ON ENDLINE
+    {
+        $$ = nuevo_comando(CMD_HISTORIAL);
+        $$->args[0] = 1;
+    }
+    | SET HISTORY OFF ENDLINE
+    {
+        $$ = nuevo_comando(CMD_HISTORIAL);
+        $$->args[0] = 0;
+    }
+    | GOTO STEP NUMBER ENDLINE
+    {
+        $$ = nuevo_comando(CMD_IR_A_PASO);
+        $$->args[0] = $3;
+    }
+    | REPLAY FROM NUMBER ENDLINE
+    {
+        $$ = nuevo_comando(CMD_REPETIR_DESDE);
+        $$->args[0] = $3;
+    }
+;
+
+sweep:
+    SWEEP STEP NUMBER barrido ENDLINE
+    // Correr NUMBER pasos con cada combinación de los valores dados, en un proceso por núcleo
+    {
+        $$ = nuevo_comando(CMD_BARRIDO);
+        $$->args[0] = $3;
+        $$->barrido = $4;
+    }
+    | SWEEP STEP NUMBER WORKERS NUMBER barrido ENDLINE
+    // Igual, pero con a lo sumo NUMBER procesos a la vez
+    {
+        $$ = nuevo_comando(CMD_BARRIDO);
+        $$->args[0] = $3;
+        $$->args[1] = $5;
+        $$->barrido = $6;
+    }
+;
+
+barrido:
+    PARAM valor
+    {
+        $$ = nuevo_barrido();
+        agregar_valor_barrido($$, $1, $2);
+    }
+    | barrido PARAM valor
+    {
+        agregar_valor_barrido($1, $2, $3);
+        $$ = $1;
+    }
+    | barrido valor
+    {
+        agregar_valor_barrido($1, $1->parametro, $2);
+        $$ = $1;
+    }
+    | barrido RANGE valor STEP valor
+    // Completar desde el último valor hasta el indicado, con el incremento dado (0.1..0.5 step 0.1)
+    {
+        agregar_rango_barrido($1, $3, $5);
+        $$ = $1;
+    }
+;
+
+valor:
+    FLOAT
+    | NUMBER { $$ = $1; }
+;
+
+modelo:
+    DEFINE MODEL '{' definicion '}' ENDLINE
+    // Reemplazar el modelo SEIRS por los estados y transiciones del bloque (uno por línea)
+    {
+        $$ = nuevo_comando(CMD_MODELO);
+        $$->modelo = $4;
+    }
+;
+
+definicion:
+    { $$ = nueva_definicion(); }
+    | definicion ENDLINE { $$ = $1; }
+    | estados ENDLINE { $$ = $1; }
+    | definicion transicion ENDLINE
+    {
+        agregar_transicion_definicion($1, $2);
+        $$ = $1;
+    }
+;
+
+estados:
+    definicion STATES { $$ = $1; }
+    | estados STATE
+    // Letras de los estados, en el orden de sus índices (V, el vacío, siempre es el 0)
+    {
+        agregar_estado_definicion($1, $2);
+        $$ = $1;
+    }
+;
+
+transicion:
+    tasa
+    | tasa IF STATE
+    // La tasa se aplica a las células con algún vecino en el estado STATE
+    {
+        $$ = $1;
+        $$.vecino = $3;
+    }
+    | tasa PER STATE
+    // Cada vecino en el estado STATE contagia por separado: 1-(1-tasa)^k con k vecinos
+    {
+        $$ = $1;
+        $$.vecino = $3;
+        $$.por_vecino = 1;
+    }
+;
+
+tasa:
+    STATE ARROW STATE RATE valor
+    {
+        Transicion transicion = {$1, $3, 0, 0, -1, $5};
+        $$ = transicion;
+    }
+    | STATE ARROW STATE RATE PARAM
+    // La tasa es el parámetro de la matriz, así un SWEEP también barre los modelos definidos
+    {
+        Transicion transicion = {$1, $3, 0, 0, $5, 0};
+        $$ = transicion;
     }
 ;
 
 make:
     MAKE SIMULATION STEP ENDLINE //avanzar un tiempo
     {   
-        printf("\nAvanzar simulación un tiempo:\n");
-        avanzar_simulacion(matriz_automatas, 1);
-        printf("\nResultados de la simulación:\n");
-        mostrar_matriz_automatas(matriz_automatas);
-        mostrar_cuadriculas_automatas(matriz_automatas);
+        $$ = nuevo_comando(CMD_SIMULAR);
+        $$->args[0] = 1;
     }
     | MAKE SIMULATION STEP NUMBER ENDLINE //avanzar "number" tiempos
     {
-        printf("\nAvanzar simulación %d tiempos:\n", $4);
-        avanzar_simulacion(matriz_automatas, $4);
-        printf("\nResultados de la simulación:\n");
-        mostrar_matriz_automatas(matriz_automatas);
-        mostrar_cuadriculas_automatas(matriz_automatas);
+        $$ = nuevo_comando(CMD_SIMULAR);
+        $$->args[0] = $4;
     }
 ;
 
 %%
 
 void yyerror(const char *s) {
+    if (sesion_actual) {
+        vaciar_texto();
+        enviar_trama(TRAMA_ERROR, (const unsigned char*)s, strlen(s));
+        return;
+    }
     fprintf(stderr, "Error: %s\n", s);
 }
 
-void mostrar_cuadriculas_automatas(MatrizAutomatas *matriz){
-    // Mostrar las cuadrículas de los autómatas
-    for (int i = 0; i < matriz->filas; i++) {
-        for (int j = 0; j < matriz->columnas; j++) {
-            printf("\nCuadrícula del autómata (%d,%d) con ID %d:\n", i, j, matriz->matriz[i][j]->id);
-            mostrar_grid(matriz->matriz[i][j]);
-        }
+// Funciones de los comandos
+// El parser solo arma comandos; ejecutar_comando los aplica. Así un bloque REPEAT o un cambio programado con
+// AT STEP se puede ejecutar muchas veces sin volver a leer la entrada.
+
+// Función para crear un comando vacío del tipo indicado
+Comando* nuevo_comando(TipoComando tipo) {
+    Comando *comando = (Comando*)calloc(1, sizeof(Comando));
+    comando->tipo = tipo;
+    return comando;
+}
+
+// Función para invertir una lista de comandos
+Comando* invertir_comandos(Comando *lista) {
+    Comando *invertida = NULL;
+    while (lista) {
+        Comando *siguiente = lista->siguiente;
+        lista->siguiente = invertida;
+        invertida = lista;
+        lista = siguiente;
     }
+    return invertida;
 }
-// Función para inicializar toda la cuadrícula del autómata como vacía
-void inicializar_grid(Automata *automata) {
-    automata->contador_S = automata->contador_E = automata->contador_I = automata->contador_R = automata->contador_V = 0;
-    for (int i = 0; i < automata->N; i++) {
-        for (int j = 0; j < automata->N; j++) {
-            automata->grid[i][j].estado = V;
-            automata->grid[i][j].prob_infeccion = 0.1;
-            automata->grid[i][j].prob_exposicion = 0.2;
-            automata->grid[i][j].prob_recuperacion = 0.1;
-            automata->grid[i][j].prob_mortalidad = 0.05;
-            automata->grid[i][j].prob_perdida_inmunidad = 0.01;
-            automata->contador_V++;
-        }
+
+// Función para copiar un comando junto con su cuerpo
+Comando* clonar_comando(Comando *comando) {
+    Comando *copia = nuevo_comando(comando->tipo);
+    *copia = *comando;
+    copia->siguiente = NULL;
+    copia->texto = comando->texto ? strdup(comando->texto) : NULL;
+    copia->barrido = comando->barrido ? clonar_barrido(comando->barrido) : NULL;
+    copia->modelo = comando->modelo ? clonar_definicion(comando->modelo) : NULL;
+    Comando **destino = &copia->cuerpo;
+    for (Comando *c = comando->cuerpo; c; c = c->siguiente) {
+        *destino = clonar_comando(c);
+        destino = &(*destino)->siguiente;
+    }
+    return copia;
+}
+
+// Función para liberar un comando y su cuerpo (no libera los comandos que le siguen en una lista)
+void liberar_comando(Comando *comando) {
+    Comando *c = comando->cuerpo;
+    while (c) {
+        Comando *siguiente = c->siguiente;
+        liberar_comando(c);
+        c = siguiente;
     }
+    free(comando->texto);
+    liberar_barrido(comando->barrido);
+    liberar_definicion(comando->modelo);
+    free(comando);
 }
 
-// Funciones para obtener y establecer el ID de un autómata
-int obtener_id(Automata *automata) {
-    return automata->id;
+// Función para aplicar un cambio programado con AT STEP cuando la simulación llega a su paso
+void ejecutar_intervencion(void *dato) {
+    Comando *intervencion = (Comando*)dato;
+    fprintf(salida, "\nCambio programado para el paso %d:\n", intervencion->args[0]);
+    ejecutar_comando(intervencion->cuerpo, 1);
 }
 
-void establecer_id(Automata *automata, int id) {
-    automata->id = id;
+// Función para liberar un cambio programado, aplicado o no
+void liberar_intervencion(void *dato) {
+    liberar_comando((Comando*)dato);
 }
 
-// Función para contar vecinos infectados considerando vecinos en autómatas adyacentes con el mismo ID
-int contar_vecinos_infectados(MatrizAutomatas *matriz, Automata *automata, int x_celula, int y_celula) {
-    int N = automata->N;
-    int infectados = 0;
+// Función para verificar que existe la matriz y, si corresponde, el autómata (m,n)
+int validar_automata(int m, int n) {
+    if (!matriz_automatas) {
+        fprintf(salida, "\nError: no hay una matriz de autómatas creada.\n");
+        return 0;
+    }
+    if (m < 0 || m >= matriz_automatas->filas || n < 0 || n >= matriz_automatas->columnas) {
+        fprintf(salida, "\nError: el autómata (%d,%d) no existe.\n", m, n);
+        return 0;
+    }
+    return 1;
+}
 
-    // Direcciones en la vecindad de Moore
-    int direcciones[8][2] = {
-        {-1, -1}, {-1, 0}, {-1, 1}, 
-        {0, -1},          {0, 1},
-        {1, -1},  {1, 0},  {1, 1}
-    };
+// Función para ejecutar un comando sobre la matriz global
+// verboso = 0 omite el mensaje por autómata (lo usa CMD_RECORRER, que muestra un resumen)
+void ejecutar_comando(Comando *comando, int verboso) {
+    int *a = comando->args;
+
+    if (comando->tipo != CMD_CREAR && comando->tipo != CMD_REPETIR && !validar_automata(0, 0)) return;
 
-    for (int d = 0; d < 8; d++) {
-        int nx = x_celula + direcciones[d][0];
-        int ny = y_celula + direcciones[d][1];
-
-        Automata *automata_vecino = automata;
-        int indice_x = automata->indice_x;
-        int indice_y = automata->indice_y;
-
-        // Si la célula vecina está fuera de los límites del autómata actual
-        if (nx < 0 || nx >= N || ny < 0 || ny >= N) {
-            int dx_automata = 0;
-            int dy_automata = 0;
-            if (nx < 0) dx_automata = -1;
-            if (nx >= N) dx_automata = 1;
-            if (ny < 0) dy_automata = -1;
-            if (ny >= N) dy_automata = 1;
-
-            int vecino_x = indice_x + dx_automata;
-            int vecino_y = indice_y + dy_automata;
-
-            // Verificamos si el autómata vecino existe
-            if (vecino_x >= 0 && vecino_x < matriz->filas && vecino_y >= 0 && vecino_y < matriz->columnas) {
-                automata_vecino = matriz->matriz[vecino_x][vecino_y];
-                if (automata_vecino->id != automata->id) continue;  // Solo consideramos vecinos con el mismo ID
-                // Ajustamos nx y ny para que apunten a la célula correcta en el autómata vecino
-                if (nx < 0) nx = N - 1;
-                if (nx >= N) nx = 0;
-                if (ny < 0) ny = N - 1;
-                if (ny >= N) ny = 0;
+    switch (comando->tipo) {
+        case CMD_CREAR:
+            if (matriz_automatas) liberar_matriz_automatas(matriz_automatas);
+            if (comando->texto) {
+                matriz_automatas = crear_matriz_automatas_respaldada(a[0], a[1], a[2], comando->texto, a[3]);
+                if (matriz_automatas) fprintf(salida, "\nAutómata celular asimétrico creado con éxito en el archivo %s%s.\n",
+                                             comando->texto, a[3] ? " (páginas grandes)" : "");
+                else fprintf(salida, "\nError: no se pudo crear la matriz en el archivo %s (si ya existe debe estar vacío).\n",
+                             comando->texto);
             } else {
-                continue;  // No hay autómata vecino, continuamos
+                matriz_automatas = crear_matriz_automatas(a[0], a[1], a[2]);
+                fprintf(salida, "\nAutómata celular asimétrico creado con éxito.\n");
+            }
+            break;
+        case CMD_ID:
+            if (!validar_automata(a[0], a[1])) return;
+            cambiar_id(matriz_automatas, a[0], a[1], a[2]);
+            if (verboso) fprintf(salida, "\nID del autómata (%d,%d) establecido como %d.\n", a[0], a[1], a[2]);
+            break;
+        case CMD_TAMANO:
+            if (!validar_automata(a[0], a[1])) return;
+            if (a[2] <= 0) {
+                fprintf(salida, "\nError: un autómata debe tener al menos una célula por lado.\n");
+                return;
             }
+            if (!cambiar_tamano(matriz_automatas, a[0], a[1], a[2])) {
+                fprintf(salida, "\nError: %dx%d células no caben en el espacio del autómata (%d,%d) en el archivo de respaldo.\n",
+                        a[2], a[2], a[0], a[1]);
+                return;
+            }
+            // Dentro de un FOR (verboso = 0) el historial se reinicia una sola vez, al terminar el recorrido
+            if (verboso) {
+                fprintf(salida, "\nAutómata (%d,%d) con %dx%d células.\n", a[0], a[1], a[2], a[2]);
+                if (reiniciar_historial(matriz_automatas)) fprintf(salida, "Historial reiniciado en el paso %d.\n", matriz_automatas->paso_actual);
+            }
+            break;
+        case CMD_AREA: {
+            if (!validar_automata(a[0], a[1])) return;
+            int estado = estado_por_letra(&matriz_automatas->modelo, comando->letra);
+            if (estado < 0) {
+                fprintf(salida, "\nError: el modelo no tiene el estado %c.\n", comando->letra);
+                return;
+            }
+            agregar_area_matriz(matriz_automatas, a[0], a[1], (Estado)estado, a[2], a[3], a[4], a[5]);
+            if (verboso) fprintf(salida, "\nÁrea de %dx%d celdas con estado %c agregada al autómata (%d,%d).\n",
+                                a[4], a[5], comando->letra, a[0], a[1]);
+            break;
         }
-
-        Celula *celula_vecina = &automata_vecino->grid[nx][ny];
-        if (celula_vecina->estado == I) {
-            infectados++;
+        case CMD_RECORRER: {
+            // args: fila inicial, fila final, columna inicial, columna final; args[4] = 1 recorre toda la matriz
+            int m0 = a[4] ? 0 : a[0], m1 = a[4] ? matriz_automatas->filas - 1 : a[1];
+            int n0 = a[4] ? 0 : a[2], n1 = a[4] ? matriz_automatas->columnas - 1 : a[3];
+            if (!validar_automata(m0, n0) || !validar_automata(m1, n1)) return;
+            if (m0 > m1 || n0 > n1) {
+                fprintf(salida, "\nError: rango de autómatas invertido (%d..%d,%d..%d); el inicio no puede ser mayor al fin.\n", m0, m1, n0, n1);
+                return;
+            }
+            if (comando->cuerpo->tipo == CMD_AREA && estado_por_letra(&matriz_automatas->modelo, comando->cuerpo->letra) < 0) {
+                fprintf(salida, "\nError: el modelo no tiene el estado %c.\n", comando->cuerpo->letra);
+                return;
+            }
+            for (int m = m0; m <= m1; m++) {
+                for (int n = n0; n <= n1; n++) {
+                    comando->cuerpo->args[0] = m;
+                    comando->cuerpo->args[1] = n;
+                    ejecutar_comando(comando->cuerpo, 0);
+                }
+            }
+            if (comando->cuerpo->tipo == CMD_ID) {
+                fprintf(salida, "\nID de los autómatas (%d..%d,%d..%d) establecido como %d.\n", m0, m1, n0, n1, comando->cuerpo->args[2]);
+            } else if (comando->cuerpo->tipo == CMD_TAMANO) {
+                fprintf(salida, "\nAutómatas (%d..%d,%d..%d) con %dx%d células.\n", m0, m1, n0, n1, comando->cuerpo->args[2], comando->cuerpo->args[2]);
+                if (reiniciar_historial(matriz_automatas)) fprintf(salida, "Historial reiniciado en el paso %d.\n", matriz_automatas->paso_actual);
+            } else {
+                fprintf(salida, "\nÁrea de %dx%d celdas con estado %c agregada a los autómatas (%d..%d,%d..%d).\n",
+                       comando->cuerpo->args[4], comando->cuerpo->args[5], comando->cuerpo->letra, m0, m1, n0, n1);
+            }
+            break;
         }
+        case CMD_PROGRAMAR:
+            if (a[0] <= matriz_automatas->paso_actual) {
+                fprintf(salida, "\nEl paso %d ya pasó; el cambio se aplica de inmediato.\n", a[0]);
+                ejecutar_comando(comando->cuerpo, verboso);
+            } else {
+                programar_intervencion(matriz_automatas, a[0], clonar_comando(comando), ejecutar_intervencion, liberar_intervencion);
+                fprintf(salida, "\nCambio programado para el paso %d.\n", a[0]);
+            }
+            break;
+        case CMD_MOTOR:
+            matriz_automatas->motor = (Motor)a[0];
+            fprintf(salida, "\nMotor de simulación por %s activado.\n", a[0] == MOTOR_EVENTOS ? "eventos" : "cuadrícula");
+            break;
+        case CMD_HISTORIAL:
+            if (a[0]) {
+                if (!matriz_automatas->historial) {
+                    matriz_automatas->historial = crear_historial(matriz_automatas);
+                }
+                fprintf(salida, "\nHistorial activado desde el paso %d.\n", matriz_automatas->paso_actual);
+            } else {
+                liberar_historial(matriz_automatas->historial);
+                matriz_automatas->historial = NULL;
+                fprintf(salida, "\nHistorial desactivado.\n");
+            }
+            break;
+        case CMD_IR_A_PASO: {
+            int reprogramadas = ir_a_paso(matriz_automatas, a[0]);
+            if (reprogramadas < 0) {
+                fprintf(salida, "\nEl paso %d no está en el historial.\n", a[0]);
+                break;
+            }
+            fprintf(salida, "\nMatriz restaurada al paso %d.\n", a[0]);
+            if (reprogramadas > 0) fprintf(salida, "Cambios programados que vuelven a la cola: %d.\n", reprogramadas);
+            break;
+        }
+        case CMD_REPETIR_DESDE:
+            repetir_desde_paso(matriz_automatas, a[0]);
+            break;
+        case CMD_MOSTRAR_IDS:
+            mostrar_matriz_ids(matriz_automatas);
+            break;
+        case CMD_MOSTRAR_CUADRICULAS:
+            mostrar_cuadriculas_automatas(matriz_automatas);
+            break;
+        case CMD_MOSTRAR_PASO:
+            mostrar_paso(matriz_automatas, a[0]);
+            break;
+        case CMD_MOSTRAR_HISTORIAL:
+            mostrar_historial(matriz_automatas);
+            break;
+        case CMD_SIMULAR:
+            if (matriz_automatas->silencioso) {
+                avanzar_simulacion(matriz_automatas, a[0]);
+                fprintf(salida, "\nSimulación en el paso %d.\n", matriz_automatas->paso_actual);
+                break;
+            }
+            if (a[0] == 1) fprintf(salida, "\nAvanzar simulación un tiempo:\n");
+            else fprintf(salida, "\nAvanzar simulación %d tiempos:\n", a[0]);
+            simular_mostrando(matriz_automatas, a[0]);
+            fprintf(salida, "\nResultados de la simulación:\n");
+            mostrar_matriz_automatas(matriz_automatas);
+            mostrar_cuadriculas_automatas(matriz_automatas);
+            break;
+        case CMD_SERIE:
+            if (a[0]) {
+                if (!matriz_automatas->serie) {
+                    matriz_automatas->serie = (SerieTiempo*)calloc(1, sizeof(SerieTiempo));
+                }
+                fprintf(salida, "\nSerie de tiempo activada desde el paso %d.\n", matriz_automatas->paso_actual);
+            } else {
+                liberar_serie(matriz_automatas->serie);
+                matriz_automatas->serie = NULL;
+                fprintf(salida, "\nSerie de tiempo desactivada.\n");
+            }
+            break;
+        case CMD_SERIE_GRUPOS:
+            // Activar los grupos también activa la serie si estaba apagada
+            if (a[0] && !matriz_automatas->serie) {
+                matriz_automatas->serie = (SerieTiempo*)calloc(1, sizeof(SerieTiempo));
+                fprintf(salida, "\nSerie de tiempo activada desde el paso %d.\n", matriz_automatas->paso_actual);
+            }
+            if (matriz_automatas->serie) matriz_automatas->serie->con_grupos = a[0];
+            if (a[0] && matriz_automatas->modelo.contagioso < 0) {
+                fprintf(salida, "\nEl modelo no tiene un estado contagioso: la serie registrará 0 grupos.\n");
+            }
+            fprintf(salida, "\nGrupos de células contagiosas en la serie %s.\n", a[0] ? "activados" : "desactivados");
+            break;
+        case CMD_MOSTRAR_GRUPOS:
+            mostrar_grupos(matriz_automatas);
+            break;
+        case CMD_SALIDA:
+            matriz_automatas->silencioso = a[0];
+            fprintf(salida, "\nSalida %s.\n", a[0] ? "silenciosa" : "detallada");
+            break;
+        case CMD_MOSTRAR_CONTADORES:
+            mostrar_contadores(matriz_automatas);
+            break;
+        case CMD_MOSTRAR_SERIE:
+            mostrar_serie(matriz_automatas);
+            break;
+        case CMD_MOSTRAR_INSTANTANEA:
+            mostrar_instantanea(matriz_automatas);
+            break;
+        case CMD_LIBERAR:
+            liberar_matriz_automatas(matriz_automatas);
+            matriz_automatas = NULL;
+            fprintf(salida, "\nMemoria liberada con éxito.\n");
+            break;
+        case CMD_REPETIR:
+            for (int r = 0; r < a[0]; r++) {
+                for (Comando *c = comando->cuerpo; c; c = c->siguiente) {
+                    ejecutar_comando(c, verboso);
+                }
+            }
+            break;
+        case CMD_BARRIDO:
+            ejecutar_barrido(matriz_automatas, comando->barrido, a[0], a[1]);
+            break;
+        case CMD_MODELO:
+            ejecutar_modelo(matriz_automatas, comando->modelo);
+            break;
+        case CMD_MOSTRAR_MODELO:
+            mostrar_modelo(matriz_automatas);
+            break;
     }
-    return infectados;
 }
 
-// Función para simular un paso en un autómata considerando vecinos
-void simular_paso_automata(MatrizAutomatas *matriz, Automata *automata, Automata *nuevo_automata) {
-    int N = automata->N;
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            Celula *celula_actual = &automata->grid[i][j];
-            Celula *celula_nueva = &nuevo_automata->grid[i][j];
-            *celula_nueva = *celula_actual;
+// Funciones para mostrar la matriz
+// La biblioteca no escribe nada; todo lo que el parser muestra en salida se arma aquí.
 
-            int infectados = contar_vecinos_infectados(matriz, automata, i, j);
-            float random_value = rand() / (float)RAND_MAX;
+// Función para avanzar la simulación mostrando cada paso (con el motor por eventos, solo cuántos eventos hubo)
+void simular_mostrando(MatrizAutomatas *matriz, int pasos) {
+    if (matriz->motor == MOTOR_EVENTOS) {
+        long eventos_antes = matriz->eventos_procesados;
+        avanzar_simulacion(matriz, pasos);
+        fprintf(salida, "\nEventos procesados: %ld\n", matriz->eventos_procesados - eventos_antes);
+        return;
+    }
+    for (int t = 1; t <= pasos; t++) {
+        fprintf(salida, "\nTiempo: %d\n", t);
+        avanzar_simulacion(matriz, 1);
+        mostrar_matriz_automatas(matriz);
+        mostrar_cuadriculas_automatas(matriz);
+    }
+}
 
-            switch (celula_actual->estado) {
-                case S:
-                    if (infectados > 0 && random_value < celula_actual->prob_exposicion) {
-                        celula_nueva->estado = E;
-                    }
-                    break;
-                case E:
-                    if (random_value < celula_actual->prob_infeccion) {
-                        celula_nueva->estado = I;
-                    }
-                    break;
-                case I:
-                    if (random_value < celula_actual->prob_recuperacion) {
-                        celula_nueva->estado = R;
-                    } else if (random_value < celula_actual->prob_mortalidad) {
-                        celula_nueva->estado = S;
-                    }
-                    break;
-                case R:
-                    if (random_value < celula_actual->prob_perdida_inmunidad) {
-                        celula_nueva->estado = S;
-                    }
-                    break;
-                case V:
-                    // No hacer nada
-                    break;
-            }
+// Función para mostrar las cuadrículas de los autómatas
+void mostrar_cuadriculas_automatas(MatrizAutomatas *matriz) {
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            fprintf(salida, "\nCuadrícula del autómata (%d,%d) con ID %d:\n", i, j, matriz->matriz[i][j]->id);
+            mostrar_grid(matriz, matriz->matriz[i][j]);
         }
     }
 }
 
-// Función para agregar un área rectangular con un estado específico en el autómata
-void agregar_area(Automata *automata, Estado estado, int inicio_fila, int inicio_columna, int filas, int columnas) {
-    for (int i = inicio_fila; i < inicio_fila + filas && i < automata->N; i++) {
-        for (int j = inicio_columna; j < inicio_columna + columnas && j < automata->N; j++) {
-            automata->grid[i][j].estado = estado;
-            // Actualizar contadores
-            switch (estado) {
-                case S: automata->contador_S++; break;
-                case E: automata->contador_E++; break;
-                case I: automata->contador_I++; break;
-                case R: automata->contador_R++; break;
-                case V: automata->contador_V++; break;
-            }
+// Función para mostrar los estados y las transiciones del modelo con sus tasas actuales
+void mostrar_modelo(MatrizAutomatas *matriz) {
+    Modelo *modelo = &matriz->modelo;
+    const char *nombres_parametros[5] = {"infección", "exposición", "recuperación", "mortalidad", "inmunidad"};
+    fprintf(salida, "\nModelo con %d estados:", modelo->cantidad_estados - 1);
+    for (int e = 1; e < modelo->cantidad_estados; e++) {
+        fprintf(salida, " %c", modelo->letras[e]);
+    }
+    fprintf(salida, "\n");
+    for (int t = 0; t < modelo->cantidad_transiciones; t++) {
+        Transicion *transicion = &modelo->transiciones[t];
+        fprintf(salida, "%c -> %c", transicion->origen, transicion->destino);
+        if (transicion->parametro >= 0) {
+            fprintf(salida, " con %s (%.4f)", nombres_parametros[transicion->parametro],
+                    *parametro_por_indice(&matriz->parametros, transicion->parametro));
+        } else {
+            fprintf(salida, " con tasa %.4f", transicion->tasa);
+        }
+        if (transicion->vecino) {
+            fprintf(salida, transicion->por_vecino ? " por cada vecino %c" : " si hay algún vecino %c", transicion->vecino);
         }
+        fprintf(salida, "\n");
     }
 }
 
-// Función para contar los estados en un autómata específico
-void contar_estados(Automata *automata) {
-    automata->contador_S = automata->contador_E = automata->contador_I = automata->contador_R = automata->contador_V = 0;
-    for (int i = 0; i < automata->N; i++) {
-        for (int j = 0; j < automata->N; j++) {
-            switch (automata->grid[i][j].estado) {
-                case S: automata->contador_S++; break;
-                case E: automata->contador_E++; break;
-                case I: automata->contador_I++; break;
-                case R: automata->contador_R++; break;
-                case V: automata->contador_V++; break;
-            }
-        }
+// Función para mostrar los contadores de cada estado del modelo, con V al final
+void mostrar_contadores_estados(const Modelo *modelo, const long long *contadores) {
+    for (int e = 1; e < modelo->cantidad_estados; e++) {
+        fprintf(salida, "%c: %lld | ", modelo->letras[e], contadores[e]);
     }
+    fprintf(salida, "V: %lld", contadores[V]);
 }
 
-// Función para imprimir la cuadrícula de un autómata específico
-void mostrar_grid(Automata *automata) {
-    for (int i = 0; i < automata->N; i++) {
-        for (int j = 0; j < automata->N; j++) {
-            switch(automata->grid[i][j].estado) {
-                case V: printf("  "); break;
-                case S: printf("S "); break;
-                case E: printf("E "); break;
-                case I: printf("I "); break;
-                case R: printf("R "); break;
-            }
+// Función para imprimir un plano de N*N células con las letras del modelo
+void mostrar_plano(MatrizAutomatas *matriz, const unsigned char *plano, int N) {
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            unsigned char estado = plano[(long long)i * N + j];
+            fprintf(salida, "%c ", estado == V ? ' ' : matriz->modelo.letras[estado]);
         }
-        printf("\n");
+        fprintf(salida, "\n");
     }
 }
 
+// Función para imprimir la cuadrícula de un autómata específico
+void mostrar_grid(MatrizAutomatas *matriz, Automata *automata) {
+    mostrar_plano(matriz, automata->estados, automata->N);
+}
+
 // Función para mostrar la matriz de autómatas con el conteo de cada estado en cada autómata
 void mostrar_matriz_automatas(MatrizAutomatas *matriz) {
-    printf("Matriz de autómatas:\n");
+    fprintf(salida, "Matriz de autómatas:\n");
     for (int i = 0; i < matriz->filas; i++) {
         for (int j = 0; j < matriz->columnas; j++) {
             Automata *automata = matriz->matriz[i][j];
             // Contar estados antes de imprimir
             contar_estados(automata);
-            printf("Autómata (%d,%d) ID: %d | S: %d | E: %d | I: %d | R: %d | V: %d\n",
-                   i, j, automata->id, automata->contador_S, automata->contador_E, automata->contador_I, automata->contador_R, automata->contador_V);
+            fprintf(salida, "Autómata (%d,%d) ID: %d | ", i, j, automata->id);
+            mostrar_contadores_estados(&matriz->modelo, automata->contadores);
+            fprintf(salida, "\n");
         }
-        printf("\n");
+        fprintf(salida, "\n");
     }
 }
 
 // Función para mostrar la matriz de IDs de autómatas
 void mostrar_matriz_ids(MatrizAutomatas *matriz) {
-    printf("\nMatriz de IDs de Autómatas:\n");
+    fprintf(salida, "\nMatriz de IDs de Autómatas:\n");
     for (int i = 0; i < matriz->filas; i++) {
         for (int j = 0; j < matriz->columnas; j++) {
             Automata *automata = matriz->matriz[i][j];
-            printf("ID:%2d ", automata->id);
+            fprintf(salida, "ID:%2d ", automata->id);
         }
-        printf("\n");
+        fprintf(salida, "\n");
     }
-    printf("\n");
+    fprintf(salida, "\n");
 }
 
-// Función para inicializar un autómata con una cuadrícula de células
-Automata* crear_automata(int id, int N, int indice_x, int indice_y) {
-    Automata *automata = (Automata*)malloc(sizeof(Automata));
-    automata->id = id;
-    automata->N = N;
-    automata->indice_x = indice_x;
-    automata->indice_y = indice_y;
-    automata->grid = (Celula**)malloc(N * sizeof(Celula*));
-    for (int i = 0; i < N; i++) {
-        automata->grid[i] = (Celula*)malloc(N * sizeof(Celula));
+// Función para mostrar los conteos y cuadrículas de unos planos reconstruidos sin modificar la matriz
+// Mismo formato que mostrar_matriz_automatas seguido de mostrar_cuadriculas_automatas, leyendo cada autómata
+// desde su tramo de los planos
+void mostrar_planos(MatrizAutomatas *matriz, const unsigned char *planos) {
+    fprintf(salida, "Matriz de autómatas:\n");
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            long long contadores[MAX_ESTADOS];
+            contar_plano(planos + indice_celula(matriz, automata, 0, 0), automata->N, contadores);
+            fprintf(salida, "Autómata (%d,%d) ID: %d | ", i, j, automata->id);
+            mostrar_contadores_estados(&matriz->modelo, contadores);
+            fprintf(salida, "\n");
+        }
+        fprintf(salida, "\n");
+    }
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            fprintf(salida, "\nCuadrícula del autómata (%d,%d) con ID %d:\n", i, j, automata->id);
+            mostrar_plano(matriz, planos + indice_celula(matriz, automata, 0, 0), automata->N);
+        }
     }
-    inicializar_grid(automata);
-    return automata;
 }
 
-// Función para liberar la memoria de un autómata
-void liberar_automata(Automata *automata) {
-    for (int i = 0; i < automata->N; i++) {
-        free(automata->grid[i]);
+// Función para mostrar el estado de la matriz en un paso del historial
+void mostrar_paso(MatrizAutomatas *matriz, int paso) {
+    unsigned char *planos = reconstruir_paso(matriz, paso, NULL);
+    if (!planos) {
+        fprintf(salida, "\nEl paso %d no está en el historial.\n", paso);
+        return;
     }
-    free(automata->grid);
-    free(automata);
+    fprintf(salida, "\nEstado en el paso %d:\n", paso);
+    mostrar_planos(matriz, planos);
+    free(planos);
 }
 
-// Función para inicializar la matriz de autómatas
-MatrizAutomatas* crear_matriz_automatas(int filas, int columnas, int N) {
-    MatrizAutomatas *matriz = (MatrizAutomatas*)malloc(sizeof(MatrizAutomatas));
-    matriz->filas = filas;
-    matriz->columnas = columnas;
-    matriz->matriz = (Automata***)malloc(filas * sizeof(Automata**));
+// Función para mostrar cada paso desde uno anterior hasta el paso actual
+void repetir_desde_paso(MatrizAutomatas *matriz, int paso) {
+    int e;
+    unsigned char *planos = reconstruir_paso(matriz, paso, &e);
+    if (!planos) {
+        fprintf(salida, "\nEl paso %d no está en el historial.\n", paso);
+        return;
+    }
+    Historial *historial = matriz->historial;
 
-    for (int i = 0; i < filas; i++) {
-        matriz->matriz[i] = (Automata**)malloc(columnas * sizeof(Automata*));
-        for (int j = 0; j < columnas; j++) {
-            int id = 1;  // Puedes cambiar el ID según tus necesidades
-            matriz->matriz[i][j] = crear_automata(id, N, i, j);
+    fprintf(salida, "\nRepetición desde el paso %d:\n", paso);
+    fprintf(salida, "\nTiempo: %d\n", paso);
+    mostrar_planos(matriz, planos);
+    for (int t = paso + 1; t <= matriz->paso_actual; t++) {
+        for (; e < historial->cantidad && historial->entradas[e].paso <= t; e++) {
+            aplicar_entrada_historial(&historial->entradas[e], planos);
         }
+        fprintf(salida, "\nTiempo: %d\n", t);
+        mostrar_planos(matriz, planos);
     }
-    return matriz;
+    free(planos);
 }
 
-// Función para liberar la memoria de la matriz de autómatas
-void liberar_matriz_automatas(MatrizAutomatas *matriz) {
-    for (int i = 0; i < matriz->filas; i++) {
-        for (int j = 0; j < matriz->columnas; j++) {
-            liberar_automata(matriz->matriz[i][j]);
+// Función para mostrar el tamaño del historial
+void mostrar_historial(MatrizAutomatas *matriz) {
+    Historial *historial = matriz->historial;
+    if (!historial) {
+        fprintf(salida, "\nEl historial está desactivado.\n");
+        return;
+    }
+    int claves = 0;
+    for (int e = 0; e < historial->cantidad; e++) {
+        claves += historial->entradas[e].es_clave;
+    }
+    fprintf(salida, "\nHistorial: pasos %d a %d | %d entradas (%d fotogramas clave) | %zu bytes\n",
+           historial->entradas[0].paso, matriz->paso_actual, historial->cantidad, claves, historial->bytes_totales);
+}
+
+// Función para mostrar la cantidad de grupos contagiosos, su tamaño y cuántos hay de cada tamaño (en potencias de 2)
+void mostrar_grupos(MatrizAutomatas *matriz) {
+    if (matriz->modelo.contagioso < 0) {
+        fprintf(salida, "\nEl modelo no tiene un estado contagioso.\n");
+        return;
+    }
+    ResumenGrupos resumen;
+    contar_grupos(matriz, &resumen, 1);
+    fprintf(salida, "\nGrupos de %c en el paso %d: %lld | células: %lld | mayor: %lld | promedio: %.2f\n",
+            matriz->modelo.letras[matriz->modelo.contagioso], matriz->paso_actual, resumen.grupos, resumen.celulas,
+            resumen.mayor, resumen.grupos ? (double)resumen.celulas / resumen.grupos : 0.0);
+    if (resumen.grupos > 0) {
+        long long histograma[64] = {0};
+        for (long long g = 0; g < resumen.grupos; g++) {
+            histograma[63 - __builtin_clzll((unsigned long long)resumen.tamanos[g])]++;
+        }
+        fprintf(salida, "Tamaños:");
+        for (int b = 0; b < 64; b++) {
+            if (!histograma[b]) continue;
+            if (b == 0) fprintf(salida, " 1: %lld |", histograma[b]);
+            else fprintf(salida, " %lld-%lld: %lld |", 1LL << b, (1LL << (b + 1)) - 1, histograma[b]);
+        }
+        fprintf(salida, "\n");
+    }
+    free(resumen.tamanos);
+}
+
+// Funciones del barrido de parámetros
+
+// Función para crear un barrido sin valores
+Barrido* nuevo_barrido(void) {
+    return (Barrido*)calloc(1, sizeof(Barrido));
+}
+
+// Función para agregar un valor a un parámetro del barrido y dejarlo como parámetro actual
+void agregar_valor_barrido(Barrido *barrido, int parametro, double valor) {
+    barrido->parametro = parametro;
+    int cantidad = barrido->cantidad[parametro];
+    barrido->valores[parametro] = (double*)realloc(barrido->valores[parametro], (cantidad + 1) * sizeof(double));
+    barrido->valores[parametro][cantidad] = valor;
+    barrido->cantidad[parametro]++;
+}
+
+// Función para agregar los valores desde el último del parámetro actual hasta fin, avanzando de a incremento
+void agregar_rango_barrido(Barrido *barrido, double fin, double incremento) {
+    int parametro = barrido->parametro;
+    double inicio = barrido->valores[parametro][barrido->cantidad[parametro] - 1];
+    if (incremento <= 0 || fin < inicio) {
+        barrido->error = 1;
+        return;
+    }
+    // El margen evita perder el último valor por el redondeo de los incrementos en coma flotante
+    int pasos = (int)floor((fin - inicio) / incremento + 1e-9);
+    for (int k = 1; k <= pasos; k++) {
+        agregar_valor_barrido(barrido, parametro, inicio + k * incremento);
+    }
+}
+
+// Función para copiar un barrido
+Barrido* clonar_barrido(Barrido *barrido) {
+    Barrido *copia = nuevo_barrido();
+    *copia = *barrido;
+    for (int p = 0; p < 5; p++) {
+        copia->valores[p] = (double*)malloc(barrido->cantidad[p] * sizeof(double));
+        memcpy(copia->valores[p], barrido->valores[p], barrido->cantidad[p] * sizeof(double));
+    }
+    return copia;
+}
+
+// Función para liberar un barrido
+void liberar_barrido(Barrido *barrido) {
+    if (!barrido) return;
+    for (int p = 0; p < 5; p++) {
+        free(barrido->valores[p]);
+    }
+    free(barrido);
+}
+
+// Función para correr el barrido desde el estado actual de la matriz y mostrar el resumen de cada combinación
+// procesos = 0 usa un proceso por núcleo disponible
+void ejecutar_barrido(MatrizAutomatas *matriz, Barrido *barrido, int pasos, int procesos) {
+    if (barrido->error) {
+        fprintf(salida, "\nError: rango del barrido mal escrito (el incremento debe ser positivo y el fin no menor al inicio).\n");
+        return;
+    }
+    long long cantidad = 1;
+    for (int p = 0; p < 5; p++) {
+        for (int v = 0; v < barrido->cantidad[p]; v++) {
+            if (barrido->valores[p][v] < 0 || barrido->valores[p][v] > 1) {
+                fprintf(salida, "\nError: las probabilidades del barrido deben estar entre 0 y 1.\n");
+                return;
+            }
+        }
+        if (barrido->cantidad[p] > 0) cantidad *= barrido->cantidad[p];
+        if (cantidad > 100000) {
+            fprintf(salida, "\nError: el barrido tiene más de 100000 combinaciones.\n");
+            return;
+        }
+    }
+    if (procesos <= 0) procesos = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (procesos > cantidad) procesos = (int)cantidad;
+
+    // Cada combinación parte de los parámetros actuales; el primer parámetro con valores es el que cambia más rápido
+    Parametros *combinaciones = (Parametros*)malloc(cantidad * sizeof(Parametros));
+    for (long long c = 0; c < cantidad; c++) {
+        long long resto = c;
+        combinaciones[c] = matriz->parametros;
+        for (int p = 0; p < 5; p++) {
+            if (barrido->cantidad[p] == 0) continue;
+            *parametro_por_indice(&combinaciones[c], p) = barrido->valores[p][resto % barrido->cantidad[p]];
+            resto /= barrido->cantidad[p];
+        }
+    }
+
+    ResultadoBarrido *resultados = (ResultadoBarrido*)malloc(cantidad * sizeof(ResultadoBarrido));
+    int completadas = barrer_parametros(matriz, combinaciones, (int)cantidad, pasos, procesos, resultados);
+
+    fprintf(salida, "\nBarrido de %lld combinaciones, %d pasos desde el paso %d, %d procesos:\n", cantidad, pasos, matriz->paso_actual, procesos);
+    fprintf(salida, "    # | infección exposición recuperación mortalidad inmunidad\n");
+    for (long long c = 0; c < cantidad; c++) {
+        Parametros *q = &combinaciones[c];
+        fprintf(salida, "%5lld | %9.4f %10.4f %12.4f %10.4f %9.4f", c, q->prob_infeccion, q->prob_exposicion,
+                q->prob_recuperacion, q->prob_mortalidad, q->prob_perdida_inmunidad);
+        ResultadoBarrido *r = &resultados[c];
+        if (!r->completado) {
+            fprintf(salida, " | falló\n");
+            continue;
+        }
+        fprintf(salida, " | ");
+        mostrar_contadores_estados(&matriz->modelo, r->totales);
+        if (matriz->modelo.contagioso >= 0) {
+            fprintf(salida, " | máx %c: %lld (paso %d)", matriz->modelo.letras[matriz->modelo.contagioso],
+                    r->max_infectados, r->paso_max_infectados);
+        }
+        fprintf(salida, "\n");
+    }
+    fprintf(salida, "\nCorridas completadas: %d de %lld.\n", completadas, cantidad);
+
+    free(combinaciones);
+    free(resultados);
+}
+
+// Funciones de la definición de modelos
+
+// Función para crear una definición de modelo vacía
+DefinicionModelo* nueva_definicion(void) {
+    DefinicionModelo *definicion = (DefinicionModelo*)calloc(1, sizeof(DefinicionModelo));
+    definicion->letras = (char*)calloc(1, 1);
+    return definicion;
+}
+
+// Función para agregar la letra de un estado a la definición
+void agregar_estado_definicion(DefinicionModelo *definicion, char letra) {
+    definicion->letras = (char*)realloc(definicion->letras, definicion->cantidad_letras + 2);
+    definicion->letras[definicion->cantidad_letras++] = letra;
+    definicion->letras[definicion->cantidad_letras] = '\0';
+}
+
+// Función para agregar una transición a la definición
+void agregar_transicion_definicion(DefinicionModelo *definicion, Transicion transicion) {
+    definicion->transiciones = (Transicion*)realloc(definicion->transiciones, (definicion->cantidad + 1) * sizeof(Transicion));
+    definicion->transiciones[definicion->cantidad++] = transicion;
+}
+
+// Función para copiar una definición de modelo
+DefinicionModelo* clonar_definicion(DefinicionModelo *definicion) {
+    DefinicionModelo *copia = nueva_definicion();
+    free(copia->letras);
+    *copia = *definicion;
+    copia->letras = strdup(definicion->letras);
+    copia->transiciones = (Transicion*)malloc((definicion->cantidad + 1) * sizeof(Transicion));
+    memcpy(copia->transiciones, definicion->transiciones, definicion->cantidad * sizeof(Transicion));
+    return copia;
+}
+
+// Función para liberar una definición de modelo
+void liberar_definicion(DefinicionModelo *definicion) {
+    if (!definicion) return;
+    free(definicion->letras);
+    free(definicion->transiciones);
+    free(definicion);
+}
+
+// Función para reemplazar el modelo de la matriz y explicar el motivo si se rechaza
+void ejecutar_modelo(MatrizAutomatas *matriz, DefinicionModelo *definicion) {
+    const char *motivos[] = {
+        NULL,
+        "el modelo no declara ningún estado (falta la línea states)",
+        "el modelo tiene más de 15 estados",
+        "las letras de los estados deben ser mayúsculas distintas entre sí y distintas de V",
+        "una transición usa un estado que el modelo no declara",
+        "las tasas deben estar entre 0 y 1 y cada transición debe cambiar de estado",
+        "todas las transiciones que dependen de los vecinos deben usar el mismo estado vecino",
+        "hay células en estados cuya letra el nuevo modelo no tiene"
+    };
+    int reubicar = !conserva_estados(&matriz->modelo, definicion->letras);
+    int resultado = definir_modelo(matriz, definicion->letras, definicion->transiciones, definicion->cantidad);
+    if (resultado != CA_MODELO_VALIDO) {
+        fprintf(salida, "\nError: %s.\n", motivos[resultado]);
+        return;
+    }
+    fprintf(salida, "\nModelo con %d estados y %d transiciones definido.\n", definicion->cantidad_letras, definicion->cantidad);
+    if (reubicar) {
+        fprintf(salida, "Las células conservan su letra en el nuevo modelo.\n");
+        if (matriz->historial) fprintf(salida, "Historial reiniciado en el paso %d.\n", matriz->paso_actual);
+    }
+}
+
+// Funciones de las respuestas del servidor
+// Cada trama es: largo del contenido (4 bytes, orden de red), tipo (1 byte) y contenido. Los enteros dentro del
+// contenido también van en orden de red. Cada comando termina con una trama TRAMA_FIN.
+
+// Función para agregar bytes a un buffer
+void buffer_agregar(Buffer *buffer, const void *datos, size_t tam) {
+    if (buffer->tam + tam > buffer->capacidad) {
+        while (buffer->tam + tam > buffer->capacidad) {
+            buffer->capacidad = buffer->capacidad ? buffer->capacidad * 2 : 256;
         }
-        free(matriz->matriz[i]);
+        buffer->datos = (unsigned char*)realloc(buffer->datos, buffer->capacidad);
     }
-    free(matriz->matriz);
+    memcpy(buffer->datos + buffer->tam, datos, tam);
+    buffer->tam += tam;
 }
 
-// Función para avanzar la simulación
-void avanzar_simulacion(MatrizAutomatas *matriz, int tiempo) {
-    // Creamos una copia de los autómatas para almacenar los nuevos estados
-    Automata ***nuevos_automatas = (Automata ***)malloc(matriz->filas * sizeof(Automata **));
+// Función para agregar un entero de 32 bits en orden de red
+void buffer_u32(Buffer *buffer, unsigned int valor) {
+    unsigned char bytes[4] = {valor >> 24, valor >> 16, valor >> 8, valor};
+    buffer_agregar(buffer, bytes, 4);
+}
+
+// Función para agregar un entero de 64 bits en orden de red
+void buffer_u64(Buffer *buffer, unsigned long long valor) {
+    buffer_u32(buffer, (unsigned int)(valor >> 32));
+    buffer_u32(buffer, (unsigned int)valor);
+}
+
+// Función para agregar los contadores de los cuatro primeros estados con letra (S, E, I, R en SEIRS) y de V
+// Los estados que el modelo no tiene van en 0, así la trama tiene el mismo formato con cualquier modelo
+void buffer_contadores(Buffer *buffer, const Modelo *modelo, const long long *contadores) {
+    for (int e = 1; e <= 4; e++) {
+        buffer_u64(buffer, e < modelo->cantidad_estados ? contadores[e] : 0);
+    }
+    buffer_u64(buffer, contadores[V]);
+}
+
+// Función para agregar los contadores de los estados que siguen a los cuatro primeros (si el modelo los tiene)
+void buffer_contadores_extra(Buffer *buffer, const Modelo *modelo, const long long *contadores) {
+    for (int e = 5; e < modelo->cantidad_estados; e++) {
+        buffer_u64(buffer, contadores[e]);
+    }
+}
+
+#ifdef __linux__
+
+// Función para escribir todos los bytes en el socket, esperando si está lleno
+// Devuelve -1 si el cliente se desconectó o si el socket sigue lleno después de ESPERA_ENVIO_MS.
+int enviar_todo(int fd, const unsigned char *datos, size_t tam) {
+    while (tam > 0) {
+        ssize_t escritos = send(fd, datos, tam, MSG_NOSIGNAL);
+        if (escritos < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                int listos = poll(&pfd, 1, ESPERA_ENVIO_MS);
+                if (listos == 0) return -1;
+                continue;
+            }
+            return -1;
+        }
+        datos += escritos;
+        tam -= escritos;
+    }
+    return 0;
+}
+
+// Función para dejar de enviarle a una sesión: con SHUT_WR el cliente lee lo ya enviado y después el fin del
+// flujo; con SHUT_RDWR también se deja de leer y el cierre llega por el ciclo de epoll
+void cortar_sesion(Sesion *sesion, int como) {
+    sesion->caida = 1;
+    shutdown(sesion->fd, como);
+}
+
+// Función para enviar una trama a la sesión actual
+// Un cliente que no lee no frena a los demás: si el envío no avanza se corta su conexión y se descarta el resto
+void enviar_trama(int tipo, const unsigned char *datos, size_t tam) {
+    unsigned char cabecera[5] = {tam >> 24, tam >> 16, tam >> 8, tam, tipo};
+    if (sesion_actual->caida) return;
+    if (enviar_todo(sesion_actual->fd, cabecera, 5) < 0 || enviar_todo(sesion_actual->fd, datos, tam) < 0) {
+        cortar_sesion(sesion_actual, SHUT_RDWR);
+    }
+}
+
+// Función para enviar como TRAMA_TEXTO lo escrito en salida hasta ahora
+void vaciar_texto(void) {
+    fclose(salida);
+    if (tam_texto_salida > 0) enviar_trama(TRAMA_TEXTO, (unsigned char*)texto_salida, tam_texto_salida);
+    free(texto_salida);
+    salida = open_memstream(&texto_salida, &tam_texto_salida);
+}
+
+#else
+
+void enviar_trama(int tipo, const unsigned char *datos, size_t tam) {}
+void vaciar_texto(void) {}
+
+#endif
+
+// Función para cerrar la respuesta a un comando (no hace nada fuera del modo servidor)
+void terminar_respuesta(int estado) {
+    if (!sesion_actual) return;
+    vaciar_texto();
+    Buffer buffer = {0};
+    buffer_u32(&buffer, estado);
+    enviar_trama(TRAMA_FIN, buffer.datos, buffer.tam);
+    free(buffer.datos);
+}
+
+// Función para mostrar los totales de cada estado (como TRAMA_CONTADORES en modo servidor)
+// Trama: paso, filas, columnas y, por autómata, su ID y los contadores S, E, I, R, V de 64 bits (ver
+// buffer_contadores). Si el modelo tiene más de cuatro estados con letra, siguen la cantidad de estados
+// adicionales y, por autómata, sus contadores.
+void mostrar_contadores(MatrizAutomatas *matriz) {
+    long long totales[MAX_ESTADOS];
+    contar_totales(matriz, totales);
+    if (!sesion_actual) {
+        fprintf(salida, "\nPaso %d | ", matriz->paso_actual);
+        mostrar_contadores_estados(&matriz->modelo, totales);
+        fprintf(salida, "\n");
+        return;
+    }
+
+    Buffer buffer = {0};
+    buffer_u32(&buffer, matriz->paso_actual);
+    buffer_u32(&buffer, matriz->filas);
+    buffer_u32(&buffer, matriz->columnas);
     for (int i = 0; i < matriz->filas; i++) {
-        nuevos_automatas[i] = (Automata **)malloc(matriz->columnas * sizeof(Automata *));
         for (int j = 0; j < matriz->columnas; j++) {
             Automata *automata = matriz->matriz[i][j];
-            nuevos_automatas[i][j] = crear_automata(automata->id, automata->N, automata->indice_x, automata->indice_y);
+            buffer_u32(&buffer, automata->id);
+            buffer_contadores(&buffer, &matriz->modelo, automata->contadores);
         }
     }
-
-    for (int t = 0; t < tiempo; t++) {
-        printf("\nTiempo: %d\n", t + 1);
-
-        // Actualización de las células considerando vecinos
+    if (matriz->modelo.cantidad_estados > 5) {
+        buffer_u32(&buffer, matriz->modelo.cantidad_estados - 5);
         for (int i = 0; i < matriz->filas; i++) {
             for (int j = 0; j < matriz->columnas; j++) {
-                Automata *automata = matriz->matriz[i][j];
-                Automata *nuevo_automata = nuevos_automatas[i][j];
-                simular_paso_automata(matriz, automata, nuevo_automata);
+                buffer_contadores_extra(&buffer, &matriz->modelo, matriz->matriz[i][j]->contadores);
             }
         }
+    }
+    vaciar_texto();
+    enviar_trama(TRAMA_CONTADORES, buffer.datos, buffer.tam);
+    free(buffer.datos);
+}
 
-        // Actualizamos los autómatas con los nuevos estados
-        for (int i = 0; i < matriz->filas; i++) {
-            for (int j = 0; j < matriz->columnas; j++) {
-                Automata *automata = matriz->matriz[i][j];
-                Automata *nuevo_automata = nuevos_automatas[i][j];
-                // Actualizamos el grid del autómata
-                for (int x = 0; x < automata->N; x++) {
-                    for (int y = 0; y < automata->N; y++) {
-                        automata->grid[x][y] = nuevo_automata->grid[x][y];
-                    }
-                }
+// Función para mostrar la serie de tiempo (como TRAMA_SERIE en modo servidor)
+// Trama: cantidad de pasos y, por paso, su número y los totales S, E, I, R, V de 64 bits; con más de cuatro
+// estados con letra siguen, como en TRAMA_CONTADORES, la cantidad de estados adicionales y sus totales por paso.
+// Con los grupos activados (SET SERIES CLUSTERS ON) cierran la trama, por paso, la cantidad de grupos y el tamaño
+// del mayor, de 64 bits (-1 en los pasos registrados antes de activarlos).
+void mostrar_serie(MatrizAutomatas *matriz) {
+    SerieTiempo *serie = matriz->serie;
+    if (!serie) {
+        fprintf(salida, "\nLa serie de tiempo está desactivada.\n");
+        return;
+    }
+    if (!sesion_actual) {
+        fprintf(salida, "\nSerie de tiempo:\n");
+        for (int p = 0; p < serie->cantidad; p++) {
+            fprintf(salida, "Paso %d | ", serie->pasos[p]);
+            mostrar_contadores_estados(&matriz->modelo, serie->totales[p]);
+            if (serie->grupos[p] >= 0) {
+                fprintf(salida, " | grupos: %lld (mayor: %lld)", serie->grupos[p], serie->mayor_grupo[p]);
             }
+            fprintf(salida, "\n");
         }
-        mostrar_matriz_automatas(matriz);
+        return;
+    }
+
+    Buffer buffer = {0};
+    buffer_u32(&buffer, serie->cantidad);
+    for (int p = 0; p < serie->cantidad; p++) {
+        buffer_u32(&buffer, serie->pasos[p]);
+        buffer_contadores(&buffer, &matriz->modelo, serie->totales[p]);
+    }
+    if (matriz->modelo.cantidad_estados > 5) {
+        buffer_u32(&buffer, matriz->modelo.cantidad_estados - 5);
+        for (int p = 0; p < serie->cantidad; p++) {
+            buffer_contadores_extra(&buffer, &matriz->modelo, serie->totales[p]);
+        }
+    }
+    if (serie->con_grupos) {
+        for (int p = 0; p < serie->cantidad; p++) {
+            buffer_u64(&buffer, (unsigned long long)serie->grupos[p]);
+            buffer_u64(&buffer, (unsigned long long)serie->mayor_grupo[p]);
+        }
+    }
+    vaciar_texto();
+    enviar_trama(TRAMA_SERIE, buffer.datos, buffer.tam);
+    free(buffer.datos);
+}
+
+// Función para mostrar las cuadrículas (como TRAMA_CUADRICULA en modo servidor)
+// Trama: paso, filas, columnas y, por autómata, su N seguido de los N*N estados (un byte cada uno)
+void mostrar_instantanea(MatrizAutomatas *matriz) {
+    if (!sesion_actual) {
         mostrar_cuadriculas_automatas(matriz);
+        return;
     }
 
-    // Liberamos la memoria de los nuevos autómatas
+    vaciar_texto();
+    Buffer buffer = {0};
+    buffer_u32(&buffer, matriz->paso_actual);
+    buffer_u32(&buffer, matriz->filas);
+    buffer_u32(&buffer, matriz->columnas);
     for (int i = 0; i < matriz->filas; i++) {
         for (int j = 0; j < matriz->columnas; j++) {
-            liberar_automata(nuevos_automatas[i][j]);
+            Automata *automata = matriz->matriz[i][j];
+            buffer_u32(&buffer, automata->N);
+            buffer_agregar(&buffer, automata->estados, (size_t)automata->N * automata->N);
         }
-        free(nuevos_automatas[i]);
     }
-    free(nuevos_automatas);
+    enviar_trama(TRAMA_CUADRICULA, buffer.datos, buffer.tam);
+    free(buffer.datos);
 }
 
+// Funciones del modo servidor
+// El hilo principal atiende los sockets con epoll y arma lotes de líneas completas; un único hilo trabajador
+// los analiza y ejecuta (el parser no es reentrante), así la simulación nunca bloquea la lectura de los clientes.
+// Cada conexión tiene su propia matriz de autómatas, que se mantiene entre comandos hasta que el cliente se desconecta.
+
+#ifdef __linux__
+
+// Función para encolar un trabajo para el hilo trabajador
+// Si los lotes pendientes de la sesión superan MAX_PENDIENTE su socket sale de epoll: el cliente queda esperando
+// con el socket lleno hasta que el trabajador se pone al día y lo vuelve a agregar (ver terminar_trabajo).
+void encolar_trabajo(Sesion *sesion, char *texto, const char *error) {
+    Trabajo *trabajo = (Trabajo*)malloc(sizeof(Trabajo));
+    trabajo->sesion = sesion;
+    trabajo->texto = texto;
+    trabajo->error = error;
+    trabajo->tam = texto ? strlen(texto) + sizeof(Trabajo) : 0;  // Muchos lotes cortos también cuentan
+    trabajo->siguiente = NULL;
+
+    pthread_mutex_lock(&mutex_trabajos);
+    sesion->pendiente += trabajo->tam;
+    if (sesion->pendiente > MAX_PENDIENTE && !sesion->pausada) {
+        sesion->pausada = 1;
+        epoll_ctl(epoll_servidor, EPOLL_CTL_DEL, sesion->fd, NULL);
+    }
+    if (ultimo_trabajo) ultimo_trabajo->siguiente = trabajo;
+    else primer_trabajo = trabajo;
+    ultimo_trabajo = trabajo;
+    pthread_cond_signal(&hay_trabajo);
+    pthread_mutex_unlock(&mutex_trabajos);
+}
+
+// Función para descontar un lote ya ejecutado (o descartado) de lo pendiente de su sesión
+// Con una sesión pausada, su socket vuelve a epoll cuando lo pendiente baja a la mitad de MAX_PENDIENTE
+void terminar_trabajo(Trabajo *trabajo) {
+    Sesion *sesion = trabajo->sesion;
+    pthread_mutex_lock(&mutex_trabajos);
+    sesion->pendiente -= trabajo->tam;
+    if (sesion->pausada && sesion->pendiente <= MAX_PENDIENTE / 2) {
+        sesion->pausada = 0;
+        struct epoll_event evento = {0};
+        evento.events = EPOLLIN | EPOLLRDHUP;
+        evento.data.ptr = sesion;
+        epoll_ctl(epoll_servidor, EPOLL_CTL_ADD, sesion->fd, &evento);
+    }
+    pthread_mutex_unlock(&mutex_trabajos);
+}
+
+// Función del hilo trabajador: ejecuta los lotes de comandos de cada sesión en orden de llegada
+void* trabajador(void *argumento) {
+    for (;;) {
+        pthread_mutex_lock(&mutex_trabajos);
+        while (!primer_trabajo) pthread_cond_wait(&hay_trabajo, &mutex_trabajos);
+        Trabajo *trabajo = primer_trabajo;
+        primer_trabajo = trabajo->siguiente;
+        if (!primer_trabajo) ultimo_trabajo = NULL;
+        pthread_mutex_unlock(&mutex_trabajos);
+
+        Sesion *sesion = trabajo->sesion;
+        if (trabajo->error) {
+            sesion_actual = sesion;
+            salida = open_memstream(&texto_salida, &tam_texto_salida);
+            yyerror(trabajo->error);
+            terminar_respuesta(1);
+            fclose(salida);
+            free(texto_salida);
+            cortar_sesion(sesion, SHUT_WR);
+            sesion_actual = NULL;
+        } else if (!trabajo->texto) {
+            // El cliente se desconectó
+            if (sesion->matriz) liberar_matriz_automatas(sesion->matriz);
+            close(sesion->fd);
+            free(sesion->entrada);
+            free(sesion);
+        } else if (sesion->caida) {
+            free(trabajo->texto);  // Nadie va a leer la respuesta
+            terminar_trabajo(trabajo);
+        } else {
+            sesion_actual = sesion;
+            matriz_automatas = sesion->matriz;
+            salida = open_memstream(&texto_salida, &tam_texto_salida);
+
+            YY_BUFFER_STATE lote = yy_scan_string(trabajo->texto);
+            if (yyparse() != 0) terminar_respuesta(1);
+            yy_delete_buffer(lote);
+
+            fclose(salida);
+            free(texto_salida);
+            sesion->matriz = matriz_automatas;
+            matriz_automatas = NULL;
+            sesion_actual = NULL;
+            free(trabajo->texto);
+            terminar_trabajo(trabajo);
+        }
+        free(trabajo);
+    }
+    return argumento;
+}
+
+// Función para pasar al hilo trabajador los primeros `tam` bytes recibidos de una sesión (con un salto de línea
+// al final si no lo tienen)
+void despachar_lote(Sesion *sesion, size_t tam) {
+    int agregar_salto = sesion->entrada[tam - 1] != '\n';
+    char *texto = (char*)malloc(tam + agregar_salto + 1);
+    memcpy(texto, sesion->entrada, tam);
+    if (agregar_salto) texto[tam] = '\n';
+    texto[tam + agregar_salto] = '\0';
+    memmove(sesion->entrada, sesion->entrada + tam, sesion->tam_entrada - tam);
+    sesion->tam_entrada -= tam;
+    encolar_trabajo(sesion, texto, NULL);
+}
+
+// Función para pasar al hilo trabajador las líneas completas recibidas de una sesión
+// Un bloque REPEAT se envía entero: solo se corta en un salto de línea fuera de llaves. Solo se recorren los bytes
+// nuevos; si lo pendiente supera MAX_LOTE sin poder cortarse, se responde un error y se descarta el resto de la
+// entrada hasta que el cliente cierre (después del error ya no se sabe dónde empieza el siguiente comando).
+void despachar_entrada(Sesion *sesion) {
+    for (size_t c = sesion->revisado; c < sesion->tam_entrada; c++) {
+        if (sesion->entrada[c] == '{') sesion->profundidad++;
+        else if (sesion->entrada[c] == '}') sesion->profundidad--;
+        else if (sesion->entrada[c] == '\n' && sesion->profundidad <= 0) {
+            sesion->corte = c + 1;
+            sesion->profundidad_corte = sesion->profundidad;
+        }
+    }
+    sesion->revisado = sesion->tam_entrada;
+
+    if (sesion->corte > 0) {
+        // Lo que queda después del corte se cuenta desde cero, como un lote nuevo
+        sesion->revisado -= sesion->corte;
+        sesion->profundidad -= sesion->profundidad_corte;
+        despachar_lote(sesion, sesion->corte);
+        sesion->corte = 0;
+    }
+    if (sesion->tam_entrada > MAX_LOTE) {
+        sesion->tam_entrada = sesion->revisado = 0;
+        sesion->descartando = 1;
+        encolar_trabajo(sesion, NULL, "lote de más de 1 MiB sin terminar (¿falta cerrar una llave?)");
+    }
+}
+
+// Función para dejar libre la ruta del socket antes de bind
+// Solo se borra un socket que quedó de un servidor que ya no corre (connect responde ECONNREFUSED); si la ruta es
+// otra cosa, o hay un servidor escuchando en ella, no se toca. Devuelve 0 si la ruta quedó libre
+int liberar_ruta_socket(const struct sockaddr_un *dir) {
+    struct stat info;
+    if (lstat(dir->sun_path, &info) < 0) {
+        if (errno == ENOENT) return 0;
+        perror("Error al revisar la ruta del socket");
+        return 1;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        fprintf(stderr, "Error: %s ya existe y no es un socket\n", dir->sun_path);
+        return 1;
+    }
+
+    int prueba = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (prueba < 0) {
+        perror("Error al abrir el socket");
+        return 1;
+    }
+    int conectado = connect(prueba, (const struct sockaddr*)dir, sizeof(*dir)) == 0;
+    int error = errno;
+    close(prueba);
+    if (conectado) {
+        fprintf(stderr, "Error: ya hay un servidor escuchando en %s\n", dir->sun_path);
+        return 1;
+    }
+    if (error != ECONNREFUSED) {
+        errno = error;
+        perror("Error al revisar el socket existente");
+        return 1;
+    }
+    if (unlink(dir->sun_path) < 0 && errno != ENOENT) {
+        perror("Error al borrar el socket anterior");
+        return 1;
+    }
+    return 0;
+}
+
+// Función para atender comandos en un socket Unix (direccion = "unix:/ruta")
+int servir(const char *direccion) {
+    if (strncmp(direccion, "unix:", 5) != 0) {
+        fprintf(stderr, "Error: dirección no soportada %s (se espera unix:/ruta)\n", direccion);
+        return 1;
+    }
+
+    struct sockaddr_un dir = {0};
+    dir.sun_family = AF_UNIX;
+    if (strlen(direccion + 5) >= sizeof(dir.sun_path)) {
+        fprintf(stderr, "Error: ruta de socket demasiado larga\n");
+        return 1;
+    }
+    strcpy(dir.sun_path, direccion + 5);
+
+    if (liberar_ruta_socket(&dir)) return 1;
+    int escucha = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (escucha < 0 || bind(escucha, (struct sockaddr*)&dir, sizeof(dir)) < 0 || listen(escucha, 64) < 0) {
+        perror("Error al abrir el socket");
+        return 1;
+    }
+
+    int epoll = epoll_servidor = epoll_create1(0);
+    struct epoll_event evento = {0};
+    evento.events = EPOLLIN;
+    evento.data.ptr = NULL;  // NULL identifica al socket de escucha
+    epoll_ctl(epoll, EPOLL_CTL_ADD, escucha, &evento);
+
+    pthread_t hilo;
+    pthread_create(&hilo, NULL, trabajador, NULL);
+    fprintf(stderr, "Servidor escuchando en %s\n", direccion);
+
+    struct epoll_event eventos[64];
+    char lectura[65536];
+    for (;;) {
+        int cantidad = epoll_wait(epoll, eventos, 64, -1);
+        for (int e = 0; e < cantidad; e++) {
+            Sesion *sesion = (Sesion*)eventos[e].data.ptr;
+            if (!sesion) {
+                int fd;
+                while ((fd = accept(escucha, NULL, NULL)) >= 0) {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    sesion = (Sesion*)calloc(1, sizeof(Sesion));
+                    sesion->fd = fd;
+                    struct epoll_event nuevo = {0};
+                    nuevo.events = EPOLLIN | EPOLLRDHUP;
+                    nuevo.data.ptr = sesion;
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &nuevo);
+                }
+                continue;
+            }
+
+            int cerrada = 0;
+            for (;;) {
+                ssize_t leidos = read(sesion->fd, lectura, sizeof(lectura));
+                if (leidos > 0) {
+                    if (sesion->descartando) continue;
+                    if (sesion->tam_entrada + leidos > sesion->capacidad_entrada) {
+                        sesion->capacidad_entrada = (sesion->tam_entrada + leidos) * 2;
+                        sesion->entrada = (char*)realloc(sesion->entrada, sesion->capacidad_entrada);
+                    }
+                    memcpy(sesion->entrada + sesion->tam_entrada, lectura, leidos);
+                    sesion->tam_entrada += leidos;
+                    // Se despacha en cada lectura para que un lote que no termina no crezca más allá de MAX_LOTE
+                    despachar_entrada(sesion);
+                    pthread_mutex_lock(&mutex_trabajos);
+                    int pausada = sesion->pausada;
+                    pthread_mutex_unlock(&mutex_trabajos);
+                    if (pausada) break;  // Se sigue leyendo cuando el trabajador vuelva a agregar el socket
+                } else if (leidos < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    cerrada = leidos == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                    break;
+                }
+            }
+            if (cerrada) {
+                // Lo último recibido se ejecuta aunque no termine en salto de línea
+                if (sesion->tam_entrada > 0) despachar_lote(sesion, sesion->tam_entrada);
+                // Desde aquí la sesión es del hilo trabajador, que la libera después de sus comandos pendientes
+                epoll_ctl(epoll, EPOLL_CTL_DEL, sesion->fd, NULL);
+                encolar_trabajo(sesion, NULL, NULL);
+            }
+        }
+    }
+    return 0;
+}
+
+#else
+
+int servir(const char *direccion) {
+    fprintf(stderr, "Error: el modo servidor requiere Linux (epoll)\n");
+    return 1;
+}
+
+#endif
+
 int main(int argc, char **argv)
 {
     srand(time(NULL));
+    salida = stdout;
+    // --serve unix:/ruta atiende comandos por socket en vez de leerlos de la entrada estándar
+    if (argc == 3 && strcmp(argv[1], "--serve") == 0) {
+        return servir(argv[2]);
+    }
     yyparse();
     return 0;
 }
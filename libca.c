@@ -0,0 +1,2138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include "automata.h"
+
+// Función para inicializar toda la cuadrícula del autómata como vacía
+void inicializar_grid(Automata *automata) {
+    long long celdas = (long long)automata->N * automata->N;
+    memset(automata->contadores, 0, sizeof(automata->contadores));
+    // Los planos respaldados vienen de un archivo recién creado o vacío, que ya se lee como ceros (V)
+    if (!automata->respaldado) {
+        memset(automata->estados, V, celdas);
+    }
+    automata->contadores[V] = celdas;
+    automata->corridas_al_dia = 0;
+}
+
+// Función para anotar que en una fila del autómata alguna célula entró o salió del estado contagioso
+// Sin corridas al día no hace falta: el próximo conteo de grupos vuelve a armar todo el autómata
+static void marcar_fila_cambiada(Automata *automata, int fila) {
+    if (automata->corridas_al_dia) automata->filas_cambiadas[fila >> 6] |= 1ULL << (fila & 63);
+}
+
+// Función para inicializar las probabilidades de transición con los valores por defecto
+void inicializar_parametros(Parametros *parametros) {
+    parametros->prob_infeccion = 0.1;
+    parametros->prob_exposicion = 0.2;
+    parametros->prob_recuperacion = 0.1;
+    parametros->prob_mortalidad = 0.05;
+    parametros->prob_perdida_inmunidad = 0.01;
+}
+
+// Función para obtener el campo de Parametros con un índice dado
+// 0 infección, 1 exposición, 2 recuperación, 3 mortalidad, 4 pérdida de inmunidad
+float* parametro_por_indice(Parametros *parametros, int parametro) {
+    switch (parametro) {
+        case 0: return &parametros->prob_infeccion;
+        case 1: return &parametros->prob_exposicion;
+        case 2: return &parametros->prob_recuperacion;
+        case 3: return &parametros->prob_mortalidad;
+        default: return &parametros->prob_perdida_inmunidad;
+    }
+}
+
+// Funciones del modelo compartimental
+// Un modelo es una lista de estados (letras) y de transiciones entre ellos con su tasa por paso, fija o tomada de
+// los parámetros de la matriz. Antes de simular se compila en una tabla densa indexada por (estado, vecinos
+// contagiosos), así el paso de una célula es un sorteo y una consulta sin importar cuántos estados tenga el modelo.
+
+// Sorteo uniforme de 31 bits (el rand() de glibc ya los da; en otras plataformas se combinan dos llamadas)
+#if RAND_MAX >= 0x7fffffff
+#define SORTEO() ((unsigned int)rand() & 0x7fffffff)
+#else
+#define SORTEO() ((((unsigned int)rand() << 16) ^ (unsigned int)rand()) & 0x7fffffff)
+#endif
+
+// Modelo SEIRS por defecto. Recuperación y mortalidad son tramos disjuntos de la misma salida de I.
+static const Transicion transiciones_seirs[] = {
+    {'S', 'E', 'I', 0, 1, 0},
+    {'E', 'I', 0, 0, 0, 0},
+    {'I', 'R', 0, 0, 2, 0},
+    {'I', 'S', 0, 0, 3, 0},
+    {'R', 'S', 0, 0, 4, 0},
+};
+
+// Función para buscar una letra entre las de los estados (-1 si no está)
+static int indice_letra(const char *letras, int cantidad, char letra) {
+    for (int e = 0; e < cantidad; e++) {
+        if (letras[e] == letra) return e;
+    }
+    return -1;
+}
+
+// Función para obtener el índice de un estado a partir de su letra (-1 si el modelo no lo tiene)
+int estado_por_letra(const Modelo *modelo, char letra) {
+    return indice_letra(modelo->letras, modelo->cantidad_estados, letra);
+}
+
+// Función para saber si cada estado del modelo actual conserva su índice con las letras de un nuevo modelo
+int conserva_estados(const Modelo *modelo, const char *letras) {
+    for (int e = 1; e < modelo->cantidad_estados; e++) {
+        if ((int)strlen(letras) < e || letras[e - 1] != modelo->letras[e]) return 0;
+    }
+    return 1;
+}
+
+// Función para pasar las células de la matriz a los índices de un nuevo modelo (mapa: índice anterior -> nuevo)
+// La serie de tiempo cambia sus columnas de la misma forma (las de estados que desaparecen se descartan) y el
+// historial vuelve a empezar con un fotograma clave del paso actual, porque sus pasos anteriores pueden tener
+// células en estados que el nuevo modelo no tiene.
+static void reubicar_estados(MatrizAutomatas *matriz, const int mapa[MAX_ESTADOS]) {
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            long long celdas = (long long)automata->N * automata->N;
+            for (long long k = 0; k < celdas; k++) {
+                automata->estados[k] = (unsigned char)mapa[automata->estados[k]];
+            }
+            contar_estados(automata);
+            automata->corridas_al_dia = 0;
+        }
+    }
+
+    SerieTiempo *serie = matriz->serie;
+    for (int p = 0; serie && p < serie->cantidad; p++) {
+        long long totales[MAX_ESTADOS] = {0};
+        for (int e = 0; e < MAX_ESTADOS; e++) {
+            if (mapa[e] >= 0) totales[mapa[e]] = serie->totales[p][e];
+        }
+        memcpy(serie->totales[p], totales, sizeof(totales));
+    }
+
+    descartar_motor_eventos(matriz);
+    if (matriz->historial) {
+        liberar_historial(matriz->historial);
+        matriz->historial = NULL;  // El nuevo fotograma clave se guarda con el modelo nuevo ya instalado
+    }
+}
+
+// Función para reemplazar el modelo de la matriz; devuelve CA_MODELO_VALIDO o el motivo del rechazo
+// La tabla se compila antes del siguiente paso, igual que cuando cambia algún parámetro. Las células conservan
+// su letra: si un estado cambia de índice, se reubican con reubicar_estados.
+int definir_modelo(MatrizAutomatas *matriz, const char *letras, const Transicion *transiciones, int cantidad) {
+    char letras_modelo[MAX_ESTADOS];
+    int largo = (int)strlen(letras);
+    if (largo == 0) return CA_MODELO_SIN_ESTADOS;
+    if (largo >= MAX_ESTADOS) return CA_MODELO_DEMASIADOS_ESTADOS;
+    int cantidad_estados = largo + 1;
+    letras_modelo[V] = 'V';
+    for (int e = 0; e < largo; e++) {
+        if (letras[e] < 'A' || letras[e] > 'Z' || letras[e] == 'V' || memchr(letras, letras[e], e)) {
+            return CA_MODELO_LETRA_INVALIDA;
+        }
+        letras_modelo[e + 1] = letras[e];
+    }
+
+    int contagioso = -1;
+    for (int t = 0; t < cantidad; t++) {
+        const Transicion *transicion = &transiciones[t];
+        int origen = indice_letra(letras_modelo, cantidad_estados, transicion->origen);
+        int destino = indice_letra(letras_modelo, cantidad_estados, transicion->destino);
+        if (origen < 0 || destino < 0) return CA_MODELO_ESTADO_DESCONOCIDO;
+        if (origen == destino || transicion->parametro < -1 || transicion->parametro > 4 ||
+            (transicion->parametro == -1 && !(transicion->tasa >= 0 && transicion->tasa <= 1))) {
+            return CA_MODELO_TASA_INVALIDA;
+        }
+        if (transicion->vecino) {
+            int vecino = indice_letra(letras_modelo, cantidad_estados, transicion->vecino);
+            if (vecino < 0) return CA_MODELO_ESTADO_DESCONOCIDO;
+            if (contagioso >= 0 && contagioso != vecino) return CA_MODELO_VARIOS_CONTAGIOSOS;
+            contagioso = vecino;
+        }
+    }
+
+    // Cada estado pasa al índice de su letra en el nuevo modelo; las células no pueden quedar en un estado que
+    // el nuevo modelo no tiene
+    Modelo *modelo = &matriz->modelo;
+    long long totales[MAX_ESTADOS];
+    int mapa[MAX_ESTADOS];
+    contar_totales(matriz, totales);
+    for (int e = 0; e < MAX_ESTADOS; e++) {
+        mapa[e] = e == V ? V : e < modelo->cantidad_estados ? indice_letra(letras_modelo, cantidad_estados, modelo->letras[e]) : -1;
+        if (mapa[e] < 0 && totales[e] > 0) return CA_MODELO_ESTADOS_EN_USO;
+    }
+    int reubicar = !conserva_estados(modelo, letras);
+    int con_historial = matriz->historial != NULL;
+    if (reubicar) reubicar_estados(matriz, mapa);
+
+    free(modelo->transiciones);
+    modelo->transiciones = (Transicion*)malloc((cantidad > 0 ? cantidad : 1) * sizeof(Transicion));
+    memcpy(modelo->transiciones, transiciones, cantidad * sizeof(Transicion));
+    modelo->cantidad_transiciones = cantidad;
+    modelo->cantidad_estados = cantidad_estados;
+    memcpy(modelo->letras, letras_modelo, cantidad_estados);
+    modelo->contagioso = contagioso;
+    matriz->modelo_al_dia = 0;
+    if (reubicar && con_historial) crear_historial(matriz);
+    return CA_MODELO_VALIDO;
+}
+
+// Función para compilar la tabla de transiciones con los parámetros actuales
+// En cada fila, las salidas hacia un mismo destino se suman y cada destino ocupa un tramo consecutivo de [0,1);
+// si las probabilidades suman más de 1 se escalan para que la suma sea 1. Una transición vecinal con "por
+// vecino" tiene probabilidad 1-(1-tasa)^k con k vecinos contagiosos; si no, basta con un vecino.
+void compilar_modelo(MatrizAutomatas *matriz) {
+    Modelo *modelo = &matriz->modelo;
+    memset(modelo->vecinal, 0, sizeof(modelo->vecinal));
+    for (int t = 0; t < modelo->cantidad_transiciones; t++) {
+        if (modelo->transiciones[t].vecino) modelo->vecinal[estado_por_letra(modelo, modelo->transiciones[t].origen)] = 1;
+    }
+
+    for (int estado = 0; estado < modelo->cantidad_estados; estado++) {
+        for (int k = 0; k < CUBETAS_VECINOS; k++) {
+            double probabilidades[MAX_ESTADOS] = {0};
+            double suma = 0;
+            for (int t = 0; t < modelo->cantidad_transiciones; t++) {
+                Transicion *transicion = &modelo->transiciones[t];
+                if (estado_por_letra(modelo, transicion->origen) != estado) continue;
+                double tasa = transicion->parametro >= 0 ? *parametro_por_indice(&matriz->parametros, transicion->parametro)
+                                                         : transicion->tasa;
+                if (tasa < 0) tasa = 0;
+                if (tasa > 1) tasa = 1;
+                double p = tasa;
+                if (transicion->vecino) p = transicion->por_vecino ? 1 - pow(1 - tasa, k) : (k > 0 ? tasa : 0);
+                probabilidades[estado_por_letra(modelo, transicion->destino)] += p;
+                suma += p;
+            }
+            double escala = suma > 1 ? 1 / suma : 1;
+
+            FilaTransicion *fila = &modelo->tabla[estado][k];
+            double acumulado = 0;
+            fila->salidas = 0;
+            for (int destino = 0; destino < modelo->cantidad_estados; destino++) {
+                if (probabilidades[destino] <= 0) continue;
+                acumulado += probabilidades[destino] * escala;
+                double umbral = acumulado * 2147483648.0;
+                fila->umbral[fila->salidas] = umbral > 2147483648.0 ? 2147483648u : (unsigned int)umbral;
+                fila->destino[fila->salidas] = destino;
+                fila->salidas++;
+            }
+            fila->probabilidad = fila->salidas ? fila->umbral[fila->salidas - 1] / 2147483648.0f : 0;
+
+            // Cada franja de la guía cubre [g*2^23, (g+1)*2^23): si cae entera dentro de un tramo (o después
+            // del último, donde la célula se queda como está) se resuelve sin mirar los umbrales
+            for (int g = 0; g < 256; g++) {
+                unsigned int inicio = (unsigned int)g << 23, fin = (unsigned int)(g + 1) << 23;
+                int s = 0;
+                while (s < fila->salidas && fila->umbral[s] <= inicio) s++;
+                if (s == fila->salidas) fila->guia[g] = estado;
+                else if (fin <= fila->umbral[s]) fila->guia[g] = fila->destino[s];
+                else fila->guia[g] = SIN_GUIA;
+            }
+        }
+    }
+    matriz->modelo_al_dia = 1;
+    descartar_motor_eventos(matriz);  // Las probabilidades del calendario ya no valen
+}
+
+// Función para obtener la fila de la tabla de un estado con una cantidad de vecinos contagiosos
+const FilaTransicion* fila_transicion(const Modelo *modelo, int estado, int contagiosos) {
+    if (!modelo->vecinal[estado]) contagiosos = 0;
+    else if (contagiosos >= CUBETAS_VECINOS) contagiosos = CUBETAS_VECINOS - 1;
+    return &modelo->tabla[estado][contagiosos];
+}
+
+// Función para elegir el estado siguiente con un sorteo uniforme en [0, 2^31)
+unsigned char sortear_transicion(const FilaTransicion *fila, unsigned char estado, unsigned int sorteo) {
+    unsigned char guia = fila->guia[sorteo >> 23];
+    if (guia != SIN_GUIA) return guia;
+    for (int s = 0; s < fila->salidas; s++) {
+        if (sorteo < fila->umbral[s]) return fila->destino[s];
+    }
+    return estado;
+}
+
+// Funciones para obtener y establecer el ID de un autómata
+int obtener_id(Automata *automata) {
+    return automata->id;
+}
+
+void establecer_id(Automata *automata, int id) {
+    automata->id = id;
+}
+
+// Función para cambiar el ID de un autómata de la matriz; los bordes se recalculan antes del siguiente paso
+void cambiar_id(MatrizAutomatas *matriz, int m, int n, int id) {
+    establecer_id(matriz->matriz[m][n], id);
+    matriz->bordes_al_dia = 0;
+    descartar_motor_eventos(matriz);
+}
+
+// Función para cambiar la cantidad de células por lado de un autómata, remuestreando su contenido
+// Cada célula nueva toma el estado de la célula anterior que contiene su esquina. Como cambian los índices
+// globales, el historial queda vencido: quien llama debe usar reiniciar_historial al terminar sus cambios.
+// Devuelve 0 si el autómata está respaldado y el nuevo tamaño no cabe en el espacio reservado en el archivo.
+int cambiar_tamano(MatrizAutomatas *matriz, int m, int n, int N) {
+    Automata *automata = matriz->matriz[m][n];
+    int N_anterior = automata->N;
+    long long celdas = (long long)N * N;
+    if (N == N_anterior) return 1;
+    if (automata->respaldado && (size_t)celdas > matriz->tam_plano_respaldo) return 0;
+
+    // El plano siguiente de un autómata respaldado ya tiene espacio reservado; en memoria se piden planos nuevos
+    unsigned char *nuevo = automata->respaldado ? automata->siguiente : (unsigned char*)malloc(celdas);
+    for (int i = 0; i < N; i++) {
+        long long fila = (long long)i * N_anterior / N * N_anterior;
+        for (int j = 0; j < N; j++) {
+            nuevo[(long long)i * N + j] = automata->estados[fila + (long long)j * N_anterior / N];
+        }
+    }
+    if (automata->respaldado) {
+        automata->siguiente = automata->estados;
+    } else {
+        free(automata->estados);
+        free(automata->siguiente);
+        automata->siguiente = (unsigned char*)malloc(celdas);
+    }
+    automata->estados = nuevo;
+    automata->N = N;
+    contar_estados(automata);
+    automata->corridas_al_dia = 0;
+
+    calcular_desplazamientos(matriz);
+    matriz->bordes_al_dia = 0;
+    descartar_motor_eventos(matriz);
+    matriz->historial_vencido = 1;
+    return 1;
+}
+
+// Función para calcular el índice global de la primera célula de cada autómata (recorriendo la matriz por filas)
+void calcular_desplazamientos(MatrizAutomatas *matriz) {
+    long long desplazamiento = 0;
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            automata->desplazamiento = desplazamiento;
+            desplazamiento += (long long)automata->N * automata->N;
+        }
+    }
+}
+
+// Función para precalcular la vecindad entre autómatas adyacentes con el mismo ID
+// Cada autómata cubre la misma superficie sin importar su N, así que la posición p de un borde de N células
+// ocupa el intervalo [p/N, (p+1)/N]. Dos células de lados opuestos de un borde son vecinas si sus intervalos
+// se tocan; con el mismo N esto da las tres células de la vecindad de Moore y la relación es simétrica, como
+// necesita el motor por eventos. En cada esquina el único vecino es la célula de la esquina del autómata diagonal.
+void calcular_bordes(MatrizAutomatas *matriz) {
+    int direcciones[8][2] = {
+        {-1, 0}, {1, 0}, {0, -1}, {0, 1},
+        {-1, -1}, {-1, 1}, {1, -1}, {1, 1}
+    };
+    matriz->max_vecinos = 8;
+
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            int N = automata->N;
+            int max_vecinos = 8;
+
+            for (int d = 0; d < 8; d++) {
+                int vecino_x = i + direcciones[d][0];
+                int vecino_y = j + direcciones[d][1];
+                Automata *vecino = NULL;
+                if (vecino_x >= 0 && vecino_x < matriz->filas && vecino_y >= 0 && vecino_y < matriz->columnas) {
+                    vecino = matriz->matriz[vecino_x][vecino_y];
+                    if (vecino->id != automata->id) vecino = NULL;  // Solo consideramos vecinos con el mismo ID
+                }
+                automata->adyacentes[d] = vecino;
+            }
+
+            for (int b = 0; b < 4; b++) {
+                Automata *vecino = automata->adyacentes[b];
+                if (!vecino) continue;
+                long long N_vecino = vecino->N;
+                int mayor_rango = 0;
+                automata->desde[b] = (int*)realloc(automata->desde[b], N * sizeof(int));
+                automata->hasta[b] = (int*)realloc(automata->hasta[b], N * sizeof(int));
+                for (int p = 0; p < N; p++) {
+                    long long desde = (p * N_vecino + N - 1) / N - 1;
+                    long long hasta = (p + 1) * N_vecino / N;
+                    if (desde < 0) desde = 0;
+                    if (hasta > N_vecino - 1) hasta = N_vecino - 1;
+                    automata->desde[b][p] = (int)desde;
+                    automata->hasta[b][p] = (int)hasta;
+                    if (hasta - desde + 1 > mayor_rango) mayor_rango = (int)(hasta - desde + 1);
+                }
+                max_vecinos += mayor_rango;
+            }
+            if (max_vecinos > matriz->max_vecinos) matriz->max_vecinos = max_vecinos;
+        }
+    }
+
+    matriz->vecinos = (Automata**)realloc(matriz->vecinos, matriz->max_vecinos * sizeof(Automata*));
+    matriz->vecinos_x = (int*)realloc(matriz->vecinos_x, matriz->max_vecinos * sizeof(int));
+    matriz->vecinos_y = (int*)realloc(matriz->vecinos_y, matriz->max_vecinos * sizeof(int));
+    matriz->bordes_al_dia = 1;
+    descartar_motor_eventos(matriz);  // Cambiaron los vecinos de las células de los bordes
+}
+
+// Función para obtener las células vecinas (vecindad de Moore) considerando autómatas adyacentes con el mismo ID
+// Devuelve la cantidad de vecinos (a lo sumo matriz->max_vecinos) y llena los arreglos con el autómata y la
+// posición de cada uno. Requiere los bordes al día (ver calcular_bordes).
+int obtener_vecinos(MatrizAutomatas *matriz, Automata *automata, int x_celula, int y_celula, Automata **automatas_vecinos, int *xs, int *ys) {
+    int N = automata->N;
+    int cantidad = 0;
+    Automata **adyacentes = automata->adyacentes;
+    (void)matriz;
+
+    // Vecinos dentro del propio autómata
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            int nx = x_celula + dx;
+            int ny = y_celula + dy;
+            if ((dx == 0 && dy == 0) || nx < 0 || nx >= N || ny < 0 || ny >= N) continue;
+            automatas_vecinos[cantidad] = automata;
+            xs[cantidad] = nx;
+            ys[cantidad] = ny;
+            cantidad++;
+        }
+    }
+
+    // Células del borde de los autómatas adyacentes que tocan a esta célula
+    if (x_celula == 0 && adyacentes[BORDE_ARRIBA]) {
+        Automata *vecino = adyacentes[BORDE_ARRIBA];
+        for (int q = automata->desde[BORDE_ARRIBA][y_celula]; q <= automata->hasta[BORDE_ARRIBA][y_celula]; q++) {
+            automatas_vecinos[cantidad] = vecino;
+            xs[cantidad] = vecino->N - 1;
+            ys[cantidad] = q;
+            cantidad++;
+        }
+    }
+    if (x_celula == N - 1 && adyacentes[BORDE_ABAJO]) {
+        Automata *vecino = adyacentes[BORDE_ABAJO];
+        for (int q = automata->desde[BORDE_ABAJO][y_celula]; q <= automata->hasta[BORDE_ABAJO][y_celula]; q++) {
+            automatas_vecinos[cantidad] = vecino;
+            xs[cantidad] = 0;
+            ys[cantidad] = q;
+            cantidad++;
+        }
+    }
+    if (y_celula == 0 && adyacentes[BORDE_IZQUIERDA]) {
+        Automata *vecino = adyacentes[BORDE_IZQUIERDA];
+        for (int q = automata->desde[BORDE_IZQUIERDA][x_celula]; q <= automata->hasta[BORDE_IZQUIERDA][x_celula]; q++) {
+            automatas_vecinos[cantidad] = vecino;
+            xs[cantidad] = q;
+            ys[cantidad] = vecino->N - 1;
+            cantidad++;
+        }
+    }
+    if (y_celula == N - 1 && adyacentes[BORDE_DERECHA]) {
+        Automata *vecino = adyacentes[BORDE_DERECHA];
+        for (int q = automata->desde[BORDE_DERECHA][x_celula]; q <= automata->hasta[BORDE_DERECHA][x_celula]; q++) {
+            automatas_vecinos[cantidad] = vecino;
+            xs[cantidad] = q;
+            ys[cantidad] = 0;
+            cantidad++;
+        }
+    }
+
+    // Esquinas: la célula de la esquina opuesta del autómata diagonal
+    int esquinas[4][3] = {
+        {ESQUINA_ARRIBA_IZQUIERDA, 0, 0}, {ESQUINA_ARRIBA_DERECHA, 0, N - 1},
+        {ESQUINA_ABAJO_IZQUIERDA, N - 1, 0}, {ESQUINA_ABAJO_DERECHA, N - 1, N - 1}
+    };
+    for (int e = 0; e < 4; e++) {
+        Automata *vecino = adyacentes[esquinas[e][0]];
+        if (!vecino || x_celula != esquinas[e][1] || y_celula != esquinas[e][2]) continue;
+        automatas_vecinos[cantidad] = vecino;
+        // Se decide por la esquina y no por la posición, que con N = 1 coincide con las cuatro esquinas
+        xs[cantidad] = e < 2 ? vecino->N - 1 : 0;
+        ys[cantidad] = e % 2 == 0 ? vecino->N - 1 : 0;
+        cantidad++;
+    }
+    return cantidad;
+}
+
+// Función para contar los vecinos en el estado contagioso del modelo, considerando autómatas adyacentes con el mismo ID
+int contar_vecinos_contagiosos(MatrizAutomatas *matriz, Automata *automata, int x_celula, int y_celula) {
+    int N = automata->N;
+    unsigned char contagioso = (unsigned char)matriz->modelo.contagioso;
+    int contagiosos = 0;
+
+    // Las células interiores tienen sus 8 vecinos en el mismo plano
+    if (x_celula > 0 && x_celula < N - 1 && y_celula > 0 && y_celula < N - 1) {
+        const unsigned char *arriba = &automata->estados[(long long)(x_celula - 1) * N + y_celula];
+        const unsigned char *centro = arriba + N;
+        const unsigned char *abajo = centro + N;
+        return (arriba[-1] == contagioso) + (arriba[0] == contagioso) + (arriba[1] == contagioso)
+             + (centro[-1] == contagioso) + (centro[1] == contagioso)
+             + (abajo[-1] == contagioso) + (abajo[0] == contagioso) + (abajo[1] == contagioso);
+    }
+
+    int cantidad = obtener_vecinos(matriz, automata, x_celula, y_celula, matriz->vecinos, matriz->vecinos_x, matriz->vecinos_y);
+    for (int v = 0; v < cantidad; v++) {
+        if (ESTADO(matriz->vecinos[v], matriz->vecinos_x[v], matriz->vecinos_y[v]) == contagioso) {
+            contagiosos++;
+        }
+    }
+    return contagiosos;
+}
+
+// Función para simular un paso en un autómata considerando vecinos
+// El resultado queda en el plano siguiente del autómata. Solo se cuentan los vecinos de los estados con
+// transiciones vecinales y solo se sortea en las filas que tienen alguna salida.
+void simular_paso_automata(MatrizAutomatas *matriz, Automata *automata) {
+    const Modelo *modelo = &matriz->modelo;
+    int contagioso = modelo->contagioso;
+    int N = automata->N;
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            long long indice = (long long)i * N + j;
+            unsigned char estado_actual = automata->estados[indice];
+            unsigned char estado_nuevo = estado_actual;
+
+            int contagiosos = modelo->vecinal[estado_actual] ? contar_vecinos_contagiosos(matriz, automata, i, j) : 0;
+            const FilaTransicion *fila = fila_transicion(modelo, estado_actual, contagiosos);
+            if (fila->salidas) estado_nuevo = sortear_transicion(fila, estado_actual, SORTEO());
+
+            automata->siguiente[indice] = estado_nuevo;
+            if (estado_nuevo != estado_actual) {
+                if (estado_actual == contagioso || estado_nuevo == contagioso) marcar_fila_cambiada(automata, i);
+                // Las células se recorren en orden de índice global, como espera historial_registrar
+                if (matriz->historial) {
+                    historial_registrar(matriz->historial, indice_celula(matriz, automata, i, j), (Estado)estado_nuevo);
+                }
+            }
+        }
+    }
+}
+
+// Función para agregar un área rectangular con un estado específico en el autómata
+void agregar_area(Automata *automata, Estado estado, int inicio_fila, int inicio_columna, int filas, int columnas) {
+    for (int i = inicio_fila; i < inicio_fila + filas && i < automata->N; i++) {
+        for (int j = inicio_columna; j < inicio_columna + columnas && j < automata->N; j++) {
+            ESTADO(automata, i, j) = estado;
+            // Actualizar contadores
+            automata->contadores[estado]++;
+        }
+        marcar_fila_cambiada(automata, i);
+    }
+}
+
+// Función para agregar un área en el autómata (m,n) de la matriz, registrándola en el historial si está activo
+void agregar_area_matriz(MatrizAutomatas *matriz, int m, int n, Estado estado, int inicio_fila, int inicio_columna, int filas, int columnas) {
+    Automata *automata = matriz->matriz[m][n];
+    agregar_area(automata, estado, inicio_fila, inicio_columna, filas, columnas);
+    historial_registrar_area(matriz, automata, inicio_fila, inicio_columna, filas, columnas);
+    descartar_motor_eventos(matriz);
+}
+
+// Función para contar los estados de un plano de N*N células
+void contar_plano(const unsigned char *plano, int N, long long contadores[MAX_ESTADOS]) {
+    memset(contadores, 0, MAX_ESTADOS * sizeof(long long));
+    for (long long c = 0; c < (long long)N * N; c++) {
+        contadores[plano[c]]++;
+    }
+}
+
+// Función para contar los estados en un autómata específico
+void contar_estados(Automata *automata) {
+    contar_plano(automata->estados, automata->N, automata->contadores);
+}
+
+// Función para inicializar un autómata con una cuadrícula de células
+Automata* crear_automata(int id, int N, int indice_x, int indice_y) {
+    long long celdas = (long long)N * N;
+    Automata *automata = crear_automata_respaldado(id, N, indice_x, indice_y,
+                                                   (unsigned char*)malloc(celdas), (unsigned char*)malloc(celdas));
+    automata->respaldado = 0;
+    inicializar_grid(automata);
+    return automata;
+}
+
+// Función para inicializar un autómata sobre planos de estados ya reservados (por ejemplo, en el archivo de respaldo)
+Automata* crear_automata_respaldado(int id, int N, int indice_x, int indice_y, unsigned char *estados, unsigned char *siguiente) {
+    Automata *automata = (Automata*)malloc(sizeof(Automata));
+    automata->id = id;
+    automata->N = N;
+    automata->indice_x = indice_x;
+    automata->indice_y = indice_y;
+    automata->estados = estados;
+    automata->siguiente = siguiente;
+    automata->respaldado = 1;
+    automata->desplazamiento = 0;
+    for (int d = 0; d < 8; d++) automata->adyacentes[d] = NULL;
+    for (int b = 0; b < 4; b++) automata->desde[b] = automata->hasta[b] = NULL;
+    automata->filas_cambiadas = NULL;
+    inicializar_grid(automata);
+    return automata;
+}
+
+// Función para liberar la memoria de un autómata
+void liberar_automata(Automata *automata) {
+    if (!automata->respaldado) {
+        free(automata->estados);
+        free(automata->siguiente);
+    }
+    for (int b = 0; b < 4; b++) {
+        free(automata->desde[b]);
+        free(automata->hasta[b]);
+    }
+    free(automata->filas_cambiadas);
+    free(automata);
+}
+
+// Función para armar una matriz de autómatas con todos sus campos en los valores iniciales
+// Con respaldo = NULL los planos se piden en memoria; si no, cada autómata ocupa dos planos consecutivos (actual y
+// siguiente) de tam_plano bytes dentro del respaldo, en el mismo orden en que avanzar_simulacion recorre la matriz.
+static MatrizAutomatas* armar_matriz(int filas, int columnas, int N, unsigned char *respaldo, size_t tam_plano) {
+    MatrizAutomatas *matriz = (MatrizAutomatas*)calloc(1, sizeof(MatrizAutomatas));
+    matriz->filas = filas;
+    matriz->columnas = columnas;
+    matriz->motor = MOTOR_CUADRICULA;
+    matriz->fd_respaldo = -1;
+    inicializar_parametros(&matriz->parametros);
+    matriz->matriz = (Automata***)malloc(filas * sizeof(Automata**));
+
+    for (int i = 0; i < filas; i++) {
+        matriz->matriz[i] = (Automata**)malloc(columnas * sizeof(Automata*));
+        for (int j = 0; j < columnas; j++) {
+            int id = 1;  // Puedes cambiar el ID según tus necesidades
+            if (respaldo) {
+                unsigned char *planos = respaldo + ((size_t)i * columnas + j) * 2 * tam_plano;
+                matriz->matriz[i][j] = crear_automata_respaldado(id, N, i, j, planos, planos + tam_plano);
+            } else {
+                matriz->matriz[i][j] = crear_automata(id, N, i, j);
+            }
+        }
+    }
+    calcular_desplazamientos(matriz);
+    definir_modelo(matriz, "SEIR", transiciones_seirs, sizeof(transiciones_seirs) / sizeof(transiciones_seirs[0]));
+    return matriz;
+}
+
+// Función para inicializar la matriz de autómatas
+MatrizAutomatas* crear_matriz_automatas(int filas, int columnas, int N) {
+    return armar_matriz(filas, columnas, N, NULL, 0);
+}
+
+// Función para inicializar la matriz de autómatas con los planos de estados en un archivo proyectado en memoria
+// El archivo se crea; uno que ya existe solo se acepta si está vacío, así nunca se pisan datos de otro archivo.
+MatrizAutomatas* crear_matriz_automatas_respaldada(int filas, int columnas, int N, const char *ruta, int paginas_grandes) {
+    size_t alineacion = paginas_grandes ? 2 * 1024 * 1024 : (size_t)sysconf(_SC_PAGESIZE);
+    size_t tam_plano = ((size_t)N * N + alineacion - 1) / alineacion * alineacion;
+    size_t tam_respaldo = (size_t)filas * columnas * 2 * tam_plano;
+
+    int creado = 1;
+    int fd = open(ruta, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        // Un archivo vacío (por ejemplo, uno creado con mktemp) se puede usar sin perder nada
+        struct stat info;
+        creado = 0;
+        fd = open(ruta, O_RDWR);
+        if (fd >= 0 && (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode) || info.st_size != 0)) {
+            fprintf(stderr, "Error: el archivo de respaldo %s ya existe y no está vacío\n", ruta);
+            close(fd);
+            return NULL;
+        }
+    }
+    if (fd < 0) {
+        perror("Error al abrir el archivo de respaldo");
+        return NULL;
+    }
+    // El archivo está vacío, así que al agrandarlo se lee como ceros, es decir, células vacías
+    if (ftruncate(fd, (off_t)tam_respaldo) < 0) {
+        perror("Error al dimensionar el archivo de respaldo");
+        close(fd);
+        if (creado) unlink(ruta);
+        return NULL;
+    }
+    unsigned char *respaldo = (unsigned char*)mmap(NULL, tam_respaldo, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (respaldo == MAP_FAILED) {
+        perror("Error al proyectar el archivo de respaldo");
+        close(fd);
+        if (creado) unlink(ruta);
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (paginas_grandes && madvise(respaldo, tam_respaldo, MADV_HUGEPAGE) < 0) {
+        perror("Aviso: no se pudieron activar páginas grandes");
+    }
+#endif
+
+    MatrizAutomatas *matriz = armar_matriz(filas, columnas, N, respaldo, tam_plano);
+    matriz->respaldo = respaldo;
+    matriz->tam_respaldo = tam_respaldo;
+    matriz->fd_respaldo = fd;
+    matriz->tam_plano_respaldo = tam_plano;
+    return matriz;
+}
+
+// Función para pedir al sistema que adelante la lectura de los planos de un autómata respaldado
+void anticipar_automata(MatrizAutomatas *matriz, int fila, int columna) {
+    if (!matriz->respaldo || fila >= matriz->filas) return;
+    Automata *automata = matriz->matriz[fila][columna];
+    size_t tam = (size_t)automata->N * automata->N;
+    madvise(automata->estados, tam, MADV_WILLNEED);
+    madvise(automata->siguiente, tam, MADV_WILLNEED);
+}
+
+// Función para liberar la memoria de la matriz de autómatas
+void liberar_matriz_automatas(MatrizAutomatas *matriz) {
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            liberar_automata(matriz->matriz[i][j]);
+        }
+        free(matriz->matriz[i]);
+    }
+    free(matriz->matriz);
+    free(matriz->vecinos);
+    free(matriz->vecinos_x);
+    free(matriz->vecinos_y);
+    liberar_historial(matriz->historial);
+    liberar_intervenciones(matriz);
+    liberar_serie(matriz->serie);
+    descartar_motor_eventos(matriz);
+    liberar_conteo_grupos(matriz);
+    liberar_hilos_grupos(matriz->hilos_grupos);
+    free(matriz->modelo.transiciones);
+    if (matriz->respaldo) {
+        munmap(matriz->respaldo, matriz->tam_respaldo);
+        close(matriz->fd_respaldo);
+    }
+    free(matriz);
+}
+
+// Función para poner al día los bordes y la tabla del modelo antes de simular
+// Se llama antes de cada paso o tramo, porque un cambio programado puede cambiar IDs, tamaños o el modelo.
+void preparar_simulacion(MatrizAutomatas *matriz) {
+    if (!matriz->bordes_al_dia) calcular_bordes(matriz);
+    if (!matriz->modelo_al_dia) compilar_modelo(matriz);
+}
+
+// Función para avanzar la simulación
+void avanzar_simulacion(MatrizAutomatas *matriz, int tiempo) {
+    if (matriz->motor == MOTOR_EVENTOS) {
+        // El motor por eventos avanza por tramos que terminan en cada cambio programado
+        int restante = tiempo;
+        while (restante > 0) {
+            int tramo = restante;
+            if (matriz->intervenciones && matriz->intervenciones->paso - matriz->paso_actual < tramo) {
+                tramo = matriz->intervenciones->paso - matriz->paso_actual;
+            }
+            preparar_simulacion(matriz);
+            avanzar_simulacion_eventos(matriz, tramo);
+            aplicar_intervenciones(matriz);
+            restante -= tramo;
+        }
+        return;
+    }
+
+    // El motor por cuadrícula cambia las células sin avisar al calendario del motor por eventos
+    descartar_motor_eventos(matriz);
+    for (int t = 0; t < tiempo; t++) {
+        preparar_simulacion(matriz);
+
+        // Actualización de las células considerando vecinos, en el orden en que están en el archivo de respaldo
+        for (int i = 0; i < matriz->filas; i++) {
+            for (int j = 0; j < matriz->columnas; j++) {
+                if (j + 1 < matriz->columnas) anticipar_automata(matriz, i, j + 1);
+                else anticipar_automata(matriz, i + 1, 0);
+                simular_paso_automata(matriz, matriz->matriz[i][j]);
+            }
+        }
+
+        // Actualizamos los autómatas con los nuevos estados intercambiando los planos
+        for (int i = 0; i < matriz->filas; i++) {
+            for (int j = 0; j < matriz->columnas; j++) {
+                Automata *automata = matriz->matriz[i][j];
+                unsigned char *plano = automata->estados;
+                automata->estados = automata->siguiente;
+                automata->siguiente = plano;
+            }
+        }
+        matriz->paso_actual++;
+        if (matriz->historial) historial_cerrar_paso(matriz);
+        aplicar_intervenciones(matriz);
+        if (matriz->serie) {
+            long long totales[MAX_ESTADOS];
+            contar_totales(matriz, totales);
+            registrar_serie(matriz, totales);
+        }
+    }
+}
+
+// Funciones del motor por eventos
+// Cada célula con alguna salida en su fila de la tabla muestrea un tiempo de espera geométrico y queda en el
+// calendario. Las filas de los estados con transiciones vecinales dependen de la cantidad de vecinos contagiosos,
+// así que el evento de esas células se reprograma cuando esa cantidad cambia la probabilidad de salir. Como la distribución geométrica no
+// tiene memoria, reprogramar o cancelar un evento no altera las probabilidades por paso del motor por cuadrícula.
+// El calendario, los vecinos contagiosos y las generaciones se guardan en la matriz entre llamadas, así avanzar de
+// a un paso cuesta lo mismo que avanzar muchos. Cualquier cambio de células, IDs, tamaños o modelo hecho fuera
+// del motor lo descarta (descartar_motor_eventos) y la siguiente llamada lo vuelve a armar.
+
+// Función para obtener una célula a partir de su índice global
+// Los autómatas pueden tener distinto N, así que se busca (en orden de la matriz) el último que empieza antes del índice
+unsigned char* celula_por_indice(MatrizAutomatas *matriz, long long indice, Automata **automata, int *x, int *y) {
+    int bajo = 0, alto = matriz->filas * matriz->columnas - 1;
+    while (bajo < alto) {
+        int medio = (bajo + alto + 1) / 2;
+        if (matriz->matriz[medio / matriz->columnas][medio % matriz->columnas]->desplazamiento <= indice) bajo = medio;
+        else alto = medio - 1;
+    }
+    *automata = matriz->matriz[bajo / matriz->columnas][bajo % matriz->columnas];
+    long long resto = indice - (*automata)->desplazamiento;
+    *x = resto / (*automata)->N;
+    *y = resto % (*automata)->N;
+    return &(*automata)->estados[resto];
+}
+
+// Función para obtener el índice global de una célula
+long long indice_celula(MatrizAutomatas *matriz, Automata *automata, int x, int y) {
+    (void)matriz;
+    return automata->desplazamiento + (long long)x * automata->N + y;
+}
+
+// Función para obtener la probabilidad por paso de que una célula cambie de estado
+float probabilidad_transicion(Modelo *modelo, Estado estado, int contagiosos) {
+    return fila_transicion(modelo, estado, contagiosos)->probabilidad;
+}
+
+// Función para muestrear la cantidad de pasos hasta la próxima transición (distribución geométrica, al menos 1)
+double muestrear_espera(float probabilidad) {
+    if (probabilidad >= 1) return 1;
+    double u = (rand() + 1.0) / ((double)RAND_MAX + 2.0);  // Uniforme en (0,1)
+    return 1 + floor(log(u) / log1p(-probabilidad));
+}
+
+// Función para agregar un evento al calendario
+void agregar_evento(MotorEventos *motor, Evento evento) {
+    Cubeta *cubeta = &motor->cubetas[evento.paso % TAM_CALENDARIO];
+    if (cubeta->cantidad == cubeta->capacidad) {
+        cubeta->capacidad = cubeta->capacidad ? cubeta->capacidad * 2 : 16;
+        cubeta->eventos = (Evento*)realloc(cubeta->eventos, cubeta->capacidad * sizeof(Evento));
+    }
+    cubeta->eventos[cubeta->cantidad++] = evento;
+}
+
+// Función para programar la próxima transición de una célula a partir del paso actual
+void programar_celula(MotorEventos *motor, long long indice, int paso_actual) {
+    Automata *automata;
+    int x, y;
+    Estado estado = *celula_por_indice(motor->matriz, indice, &automata, &x, &y);
+    float probabilidad = probabilidad_transicion(&motor->matriz->modelo, estado, motor->vecinos_contagiosos[indice]);
+    if (probabilidad <= 0) return;
+
+    double paso = paso_actual + muestrear_espera(probabilidad);
+    if (paso > INT_MAX) return;  // No ocurre en ningún paso representable
+
+    Evento evento = {indice, motor->generacion[indice], (int)paso};
+    agregar_evento(motor, evento);
+}
+
+// Función para determinar el nuevo estado de una célula cuyo evento se cumplió
+// Condicionado a que la célula cambia, el sorteo es uniforme en el tramo de las salidas de su fila
+Estado resolver_transicion(Modelo *modelo, Estado estado, int contagiosos) {
+    const FilaTransicion *fila = fila_transicion(modelo, estado, contagiosos);
+    if (!fila->salidas) return estado;
+    unsigned int sorteo = (unsigned int)(((unsigned long long)SORTEO() * fila->umbral[fila->salidas - 1]) >> 31);
+    return (Estado)sortear_transicion(fila, estado, sorteo);
+}
+
+// Función para actualizar los contadores de vecinos contagiosos cuando una célula entra o sale del estado contagioso
+void propagar_cambio_contagioso(MotorEventos *motor, long long indice, int delta, int paso_actual) {
+    MatrizAutomatas *matriz = motor->matriz;
+    Modelo *modelo = &matriz->modelo;
+    Automata *automata, **automatas_vecinos = matriz->vecinos;
+    int x, y, *xs = matriz->vecinos_x, *ys = matriz->vecinos_y;
+    celula_por_indice(matriz, indice, &automata, &x, &y);
+
+    int cantidad = obtener_vecinos(matriz, automata, x, y, automatas_vecinos, xs, ys);
+    for (int v = 0; v < cantidad; v++) {
+        long long vecino = indice_celula(matriz, automatas_vecinos[v], xs[v], ys[v]);
+        int antes = motor->vecinos_contagiosos[vecino];
+        motor->vecinos_contagiosos[vecino] = antes + delta;
+        Estado estado = (Estado)ESTADO(automatas_vecinos[v], xs[v], ys[v]);
+        if (!modelo->vecinal[estado]) continue;
+
+        // El evento de la célula solo cambia si cambia su probabilidad de salir (en SEIRS, al pasar de cero
+        // vecinos infectados a alguno o al revés)
+        if (probabilidad_transicion(modelo, estado, antes) != probabilidad_transicion(modelo, estado, antes + delta)) {
+            motor->generacion[vecino]++;
+            programar_celula(motor, vecino, paso_actual);
+        }
+    }
+}
+
+// Función para ordenar los cambios por índice de célula
+int comparar_cambios(const void *a, const void *b) {
+    long long ia = ((const Cambio*)a)->celula;
+    long long ib = ((const Cambio*)b)->celula;
+    return (ia > ib) - (ia < ib);
+}
+
+// Función para armar el estado del motor por eventos a partir de las células actuales de la matriz
+MotorEventos* crear_motor_eventos(MatrizAutomatas *matriz) {
+    long long total = total_celulas(matriz);
+
+    MotorEventos *motor = (MotorEventos*)calloc(1, sizeof(MotorEventos));
+    motor->matriz = matriz;
+    motor->vecinos_contagiosos = (int*)calloc(total, sizeof(int));
+    motor->generacion = (int*)calloc(total, sizeof(int));
+
+    // Contamos los vecinos contagiosos iniciales y programamos la primera transición de cada célula
+    int contagioso = matriz->modelo.contagioso;
+    for (long long indice = 0; contagioso >= 0 && indice < total; indice++) {
+        Automata *automata;
+        int x, y;
+        if (*celula_por_indice(matriz, indice, &automata, &x, &y) == contagioso) {
+            int cantidad = obtener_vecinos(matriz, automata, x, y, matriz->vecinos, matriz->vecinos_x, matriz->vecinos_y);
+            for (int v = 0; v < cantidad; v++) {
+                motor->vecinos_contagiosos[indice_celula(matriz, matriz->vecinos[v], matriz->vecinos_x[v], matriz->vecinos_y[v])]++;
+            }
+        }
+    }
+    for (long long indice = 0; indice < total; indice++) {
+        programar_celula(motor, indice, matriz->paso_actual);
+    }
+    contar_totales(matriz, motor->totales);
+    return motor;
+}
+
+// Función para descartar el estado del motor por eventos (se vuelve a armar en la siguiente llamada)
+void descartar_motor_eventos(MatrizAutomatas *matriz) {
+    MotorEventos *motor = matriz->eventos;
+    if (!motor) return;
+    for (int b = 0; b < TAM_CALENDARIO; b++) {
+        free(motor->cubetas[b].eventos);
+    }
+    free(motor->vecinos_contagiosos);
+    free(motor->generacion);
+    free(motor);
+    matriz->eventos = NULL;
+}
+
+// Función para avanzar la simulación procesando solo las transiciones que ocurren
+void avanzar_simulacion_eventos(MatrizAutomatas *matriz, int tiempo) {
+    if (!matriz->eventos) matriz->eventos = crear_motor_eventos(matriz);
+    MotorEventos *motor = matriz->eventos;
+    int contagioso = matriz->modelo.contagioso;
+
+    Cambio *cambios = NULL;
+    int capacidad_cambios = 0;
+
+    int paso_final = matriz->paso_actual + tiempo;
+    for (int t = matriz->paso_actual + 1; t <= paso_final; t++) {
+        Cubeta *cubeta = &motor->cubetas[t % TAM_CALENDARIO];
+        int cantidad_cambios = 0;
+        int restantes = 0;
+
+        // Resolvemos los eventos del paso sin aplicarlos, para que todos vean el estado del paso anterior
+        for (int e = 0; e < cubeta->cantidad; e++) {
+            Evento evento = cubeta->eventos[e];
+            if (evento.paso != t) {
+                cubeta->eventos[restantes++] = evento;  // Pertenece a una vuelta posterior del calendario
+                continue;
+            }
+            if (evento.generacion != motor->generacion[evento.celula]) continue;  // Evento caducado
+
+            Automata *automata;
+            int x, y;
+            Estado estado = *celula_por_indice(matriz, evento.celula, &automata, &x, &y);
+            if (cantidad_cambios == capacidad_cambios) {
+                capacidad_cambios = capacidad_cambios ? capacidad_cambios * 2 : 64;
+                cambios = (Cambio*)realloc(cambios, capacidad_cambios * sizeof(Cambio));
+            }
+            cambios[cantidad_cambios].celula = evento.celula;
+            cambios[cantidad_cambios].estado = resolver_transicion(&matriz->modelo, estado, motor->vecinos_contagiosos[evento.celula]);
+            cantidad_cambios++;
+        }
+        cubeta->cantidad = restantes;
+        matriz->eventos_procesados += cantidad_cambios;
+
+        // Aplicamos los cambios y actualizamos los vecinos contagiosos
+        for (int c = 0; c < cantidad_cambios; c++) {
+            Automata *automata;
+            int x, y;
+            unsigned char *celula = celula_por_indice(matriz, cambios[c].celula, &automata, &x, &y);
+            Estado anterior = *celula;
+            *celula = cambios[c].estado;
+            motor->totales[anterior]--;
+            motor->totales[cambios[c].estado]++;
+            motor->generacion[cambios[c].celula]++;
+            if ((int)anterior == contagioso) propagar_cambio_contagioso(motor, cambios[c].celula, -1, t);
+            if ((int)cambios[c].estado == contagioso) propagar_cambio_contagioso(motor, cambios[c].celula, 1, t);
+            if ((int)anterior == contagioso || (int)cambios[c].estado == contagioso) marcar_fila_cambiada(automata, x);
+        }
+
+        // Programamos la siguiente transición de las células que cambiaron, ya con los vecinos actualizados
+        for (int c = 0; c < cantidad_cambios; c++) {
+            motor->generacion[cambios[c].celula]++;
+            programar_celula(motor, cambios[c].celula, t);
+        }
+
+        matriz->paso_actual = t;
+        if (matriz->historial) {
+            if (cantidad_cambios > 1) qsort(cambios, cantidad_cambios, sizeof(Cambio), comparar_cambios);
+            for (int c = 0; c < cantidad_cambios; c++) {
+                historial_registrar(matriz->historial, cambios[c].celula, cambios[c].estado);
+            }
+            historial_cerrar_paso(matriz);
+        }
+        if (matriz->serie) registrar_serie(matriz, motor->totales);
+    }
+
+    free(cambios);
+}
+
+// Funciones del historial de pasos
+// Cada paso guarda solo las células que cambiaron. Cuando los deltas acumulados desde el último fotograma clave
+// superan el tamaño de ese fotograma, se guarda uno nuevo; así la memoria crece con la actividad y reconstruir
+// un paso nunca aplica más bytes de delta que los de un estado completo.
+
+// Función para contar las células de toda la matriz
+long long total_celulas(MatrizAutomatas *matriz) {
+    long long total = 0;
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            total += (long long)matriz->matriz[i][j]->N * matriz->matriz[i][j]->N;
+        }
+    }
+    return total;
+}
+
+// Función para agregar un byte al buffer del historial
+void escribir_byte(Historial *historial, unsigned char byte) {
+    if (historial->tam_delta == historial->capacidad_delta) {
+        historial->capacidad_delta = historial->capacidad_delta ? historial->capacidad_delta * 2 : 256;
+        historial->delta = (unsigned char*)realloc(historial->delta, historial->capacidad_delta);
+    }
+    historial->delta[historial->tam_delta++] = byte;
+}
+
+// Función para agregar un entero sin signo como varint (7 bits por byte, el bit alto indica que sigue otro byte)
+void escribir_varint(Historial *historial, unsigned long long valor) {
+    while (valor >= 0x80) {
+        escribir_byte(historial, (unsigned char)(valor | 0x80));
+        valor >>= 7;
+    }
+    escribir_byte(historial, (unsigned char)valor);
+}
+
+// Función para leer un varint y avanzar el puntero
+unsigned long long leer_varint(unsigned char **datos) {
+    unsigned long long valor = 0;
+    int desplazamiento = 0;
+    unsigned char byte;
+    do {
+        byte = *(*datos)++;
+        valor |= (unsigned long long)(byte & 0x7f) << desplazamiento;
+        desplazamiento += 7;
+    } while (byte & 0x80);
+    return valor;
+}
+
+// Función para escribir la corrida abierta del delta en construcción
+void cerrar_corrida(Historial *historial) {
+    if (historial->fin_corrida < 0) return;
+    escribir_varint(historial, historial->inicio_corrida - historial->fin_anterior);
+    escribir_varint(historial, historial->fin_corrida - historial->inicio_corrida);
+    escribir_byte(historial, historial->estado_corrida);
+    historial->fin_anterior = historial->fin_corrida;
+    historial->fin_corrida = -1;
+}
+
+// Función para guardar el buffer actual como una nueva entrada del historial
+void agregar_entrada_historial(Historial *historial, int paso, int es_clave) {
+    if (historial->cantidad == historial->capacidad) {
+        historial->capacidad = historial->capacidad ? historial->capacidad * 2 : 64;
+        historial->entradas = (EntradaHistorial*)realloc(historial->entradas, historial->capacidad * sizeof(EntradaHistorial));
+    }
+    EntradaHistorial *entrada = &historial->entradas[historial->cantidad++];
+    entrada->paso = paso;
+    entrada->es_clave = es_clave;
+    entrada->tam = historial->tam_delta;
+    entrada->datos = (unsigned char*)malloc(entrada->tam ? entrada->tam : 1);
+    memcpy(entrada->datos, historial->delta, entrada->tam);
+    historial->bytes_totales += entrada->tam;
+
+    historial->tam_delta = 0;
+    historial->fin_anterior = 0;
+    historial->fin_corrida = -1;
+}
+
+// Función para crear el historial de una matriz, partiendo con un fotograma clave del paso actual
+Historial* crear_historial(MatrizAutomatas *matriz) {
+    Historial *historial = (Historial*)calloc(1, sizeof(Historial));
+    historial->fin_corrida = -1;
+    matriz->historial = historial;
+    historial_agregar_clave(matriz);
+    return historial;
+}
+
+// Función para liberar el historial
+void liberar_historial(Historial *historial) {
+    if (!historial) return;
+    for (int e = 0; e < historial->cantidad; e++) {
+        free(historial->entradas[e].datos);
+    }
+    free(historial->entradas);
+    free(historial->delta);
+    free(historial);
+}
+
+// Función para que el historial vuelva a empezar con un fotograma clave del paso actual si algún cambio de
+// tamaño lo dejó vencido. Así un recorrido que cambia muchos autómatas lo reinicia una sola vez.
+// Devuelve 1 si lo reinició
+int reiniciar_historial(MatrizAutomatas *matriz) {
+    if (!matriz->historial_vencido) return 0;
+    matriz->historial_vencido = 0;
+    if (!matriz->historial) return 0;
+    liberar_historial(matriz->historial);
+    crear_historial(matriz);
+    return 1;
+}
+
+// Función para registrar el nuevo estado de una célula en el delta del paso en construcción
+// Los índices de un mismo delta deben llegar en orden creciente
+void historial_registrar(Historial *historial, long long indice, Estado estado) {
+    if (historial->fin_corrida == indice && historial->estado_corrida == estado) {
+        historial->fin_corrida++;
+        return;
+    }
+    cerrar_corrida(historial);
+    historial->inicio_corrida = indice;
+    historial->fin_corrida = indice + 1;
+    historial->estado_corrida = estado;
+}
+
+// Función para guardar el delta del paso actual y, si corresponde, un nuevo fotograma clave
+void historial_cerrar_paso(MatrizAutomatas *matriz) {
+    Historial *historial = matriz->historial;
+    cerrar_corrida(historial);
+    if (historial->tam_delta == 0) return;  // Nada cambió
+
+    historial->bytes_desde_clave += historial->tam_delta;
+    agregar_entrada_historial(historial, matriz->paso_actual, 0);
+
+    size_t limite = historial->tam_ultima_clave > MIN_BYTES_ENTRE_CLAVES ? historial->tam_ultima_clave : MIN_BYTES_ENTRE_CLAVES;
+    if (historial->bytes_desde_clave >= limite) {
+        historial_agregar_clave(matriz);
+    }
+}
+
+// Función para registrar en el historial un área modificada fuera de la simulación
+void historial_registrar_area(MatrizAutomatas *matriz, Automata *automata, int inicio_fila, int inicio_columna, int filas, int columnas) {
+    if (!matriz->historial) return;
+    for (int i = inicio_fila; i < inicio_fila + filas && i < automata->N; i++) {
+        for (int j = inicio_columna; j < inicio_columna + columnas && j < automata->N; j++) {
+            historial_registrar(matriz->historial, indice_celula(matriz, automata, i, j), ESTADO(automata, i, j));
+        }
+    }
+    historial_cerrar_paso(matriz);
+}
+
+// Función para guardar el estado completo de la matriz como fotograma clave del paso actual
+void historial_agregar_clave(MatrizAutomatas *matriz) {
+    Historial *historial = matriz->historial;
+
+    // Los deltas del mismo paso quedan cubiertos por el fotograma clave
+    while (historial->cantidad > 0 && !historial->entradas[historial->cantidad - 1].es_clave
+           && historial->entradas[historial->cantidad - 1].paso == matriz->paso_actual) {
+        historial->cantidad--;
+        historial->bytes_totales -= historial->entradas[historial->cantidad].tam;
+        free(historial->entradas[historial->cantidad].datos);
+    }
+
+    unsigned char estado_corrida = V;
+    long long largo = 0;
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            long long celdas = (long long)automata->N * automata->N;
+            for (long long c = 0; c < celdas; c++) {
+                if (automata->estados[c] != estado_corrida && largo > 0) {
+                    escribir_byte(historial, estado_corrida);
+                    escribir_varint(historial, largo);
+                    largo = 0;
+                }
+                estado_corrida = automata->estados[c];
+                largo++;
+            }
+        }
+    }
+    if (largo > 0) {
+        escribir_byte(historial, estado_corrida);
+        escribir_varint(historial, largo);
+    }
+
+    historial->tam_ultima_clave = historial->tam_delta;
+    historial->bytes_desde_clave = 0;
+    agregar_entrada_historial(historial, matriz->paso_actual, 1);
+}
+
+// Función para aplicar una entrada del historial sobre los planos de todas las células
+void aplicar_entrada_historial(EntradaHistorial *entrada, unsigned char *planos) {
+    unsigned char *datos = entrada->datos;
+    unsigned char *fin = entrada->datos + entrada->tam;
+    long long posicion = 0;
+    while (datos < fin) {
+        if (entrada->es_clave) {
+            unsigned char estado = *datos++;
+            long long largo = leer_varint(&datos);
+            memset(planos + posicion, estado, largo);
+            posicion += largo;
+        } else {
+            posicion += leer_varint(&datos);
+            long long largo = leer_varint(&datos);
+            unsigned char estado = *datos++;
+            memset(planos + posicion, estado, largo);
+            posicion += largo;
+        }
+    }
+}
+
+// Función para reconstruir el estado de un paso desde el fotograma clave más cercano
+// Devuelve los planos de todas las células en orden de índice global (o NULL si el paso no está en el historial)
+// y deja en siguiente_entrada la primera entrada posterior al paso
+unsigned char* reconstruir_paso(MatrizAutomatas *matriz, int paso, int *siguiente_entrada) {
+    Historial *historial = matriz->historial;
+    if (!historial || paso > matriz->paso_actual) return NULL;
+
+    int clave = -1;
+    for (int e = historial->cantidad - 1; e >= 0; e--) {
+        if (historial->entradas[e].es_clave && historial->entradas[e].paso <= paso) {
+            clave = e;
+            break;
+        }
+    }
+    if (clave < 0) return NULL;
+
+    unsigned char *planos = (unsigned char*)malloc(total_celulas(matriz));
+    int e = clave;
+    for (; e < historial->cantidad && historial->entradas[e].paso <= paso; e++) {
+        aplicar_entrada_historial(&historial->entradas[e], planos);
+    }
+    if (siguiente_entrada) *siguiente_entrada = e;
+    return planos;
+}
+
+// Función para devolver la matriz al estado de un paso anterior, descartando el historial y la serie posteriores
+// Devuelve la cantidad de cambios programados que vuelven a la cola, o -1 si el paso no está en el historial.
+int ir_a_paso(MatrizAutomatas *matriz, int paso) {
+    int siguiente_entrada;
+    unsigned char *planos = reconstruir_paso(matriz, paso, &siguiente_entrada);
+    if (!planos) return -1;
+
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            memcpy(automata->estados, planos + indice_celula(matriz, automata, 0, 0), (size_t)automata->N * automata->N);
+            contar_estados(automata);
+            automata->corridas_al_dia = 0;
+        }
+    }
+    free(planos);
+    descartar_motor_eventos(matriz);
+
+    Historial *historial = matriz->historial;
+    while (historial->cantidad > siguiente_entrada) {
+        historial->cantidad--;
+        historial->bytes_totales -= historial->entradas[historial->cantidad].tam;
+        free(historial->entradas[historial->cantidad].datos);
+    }
+    // Al volver a avanzar la serie se registra otra vez desde aquí, sin repetir ni desordenar pasos
+    SerieTiempo *serie = matriz->serie;
+    while (serie && serie->cantidad > 0 && serie->pasos[serie->cantidad - 1] > paso) {
+        serie->cantidad--;
+    }
+    matriz->paso_actual = paso;
+    historial_agregar_clave(matriz);
+    return reprogramar_intervenciones(matriz, paso);
+}
+
+// Funciones de los cambios programados
+
+// Los cambios aplicados no se descartan: pasan a un registro ordenado por paso, y al volver con ir_a_paso a un
+// paso anterior los que quedaron adelante vuelven a la cola, así se aplican otra vez al avanzar de nuevo.
+
+// Función para insertar un cambio en la cola, después de los que tienen su mismo paso
+void encolar_intervencion(MatrizAutomatas *matriz, Intervencion *intervencion) {
+    Intervencion **posicion = &matriz->intervenciones;
+    while (*posicion && (*posicion)->paso <= intervencion->paso) {
+        posicion = &(*posicion)->siguiente;
+    }
+    intervencion->siguiente = *posicion;
+    *posicion = intervencion;
+}
+
+// Función para encolar un cambio programado, manteniendo la cola ordenada por paso
+void programar_intervencion(MatrizAutomatas *matriz, int paso, void *dato, void (*aplicar)(void *dato), void (*liberar)(void *dato)) {
+    Intervencion *intervencion = (Intervencion*)malloc(sizeof(Intervencion));
+    intervencion->paso = paso;
+    intervencion->dato = dato;
+    intervencion->aplicar = aplicar;
+    intervencion->liberar = liberar;
+    encolar_intervencion(matriz, intervencion);
+}
+
+// Función para aplicar los cambios programados hasta el paso actual y pasarlos al registro de aplicados
+void aplicar_intervenciones(MatrizAutomatas *matriz) {
+    Intervencion **final = &matriz->aplicadas;
+    while (*final) final = &(*final)->siguiente;
+    while (matriz->intervenciones && matriz->intervenciones->paso <= matriz->paso_actual) {
+        Intervencion *intervencion = matriz->intervenciones;
+        matriz->intervenciones = intervencion->siguiente;
+        intervencion->aplicar(intervencion->dato);
+        intervencion->siguiente = NULL;
+        *final = intervencion;
+        final = &intervencion->siguiente;
+    }
+}
+
+// Función para devolver a la cola los cambios aplicados después del paso indicado
+// Devuelve cuántos volvieron a la cola
+int reprogramar_intervenciones(MatrizAutomatas *matriz, int paso) {
+    Intervencion **posicion = &matriz->aplicadas;
+    while (*posicion && (*posicion)->paso <= paso) {
+        posicion = &(*posicion)->siguiente;
+    }
+    Intervencion *intervencion = *posicion;
+    *posicion = NULL;
+    int cantidad = 0;
+    while (intervencion) {
+        Intervencion *siguiente = intervencion->siguiente;
+        encolar_intervencion(matriz, intervencion);
+        intervencion = siguiente;
+        cantidad++;
+    }
+    return cantidad;
+}
+
+// Función para liberar una lista de cambios programados
+static void liberar_lista_intervenciones(Intervencion *intervencion) {
+    while (intervencion) {
+        Intervencion *siguiente = intervencion->siguiente;
+        if (intervencion->liberar) intervencion->liberar(intervencion->dato);
+        free(intervencion);
+        intervencion = siguiente;
+    }
+}
+
+// Función para liberar los cambios programados, pendientes y aplicados
+void liberar_intervenciones(MatrizAutomatas *matriz) {
+    liberar_lista_intervenciones(matriz->intervenciones);
+    liberar_lista_intervenciones(matriz->aplicadas);
+    matriz->intervenciones = matriz->aplicadas = NULL;
+}
+
+// Funciones de la serie de tiempo
+
+// Función para sumar los contadores de todos los autómatas (indexados por Estado)
+void contar_totales(MatrizAutomatas *matriz, long long totales[MAX_ESTADOS]) {
+    memset(totales, 0, MAX_ESTADOS * sizeof(long long));
+    for (int i = 0; i < matriz->filas; i++) {
+        for (int j = 0; j < matriz->columnas; j++) {
+            Automata *automata = matriz->matriz[i][j];
+            contar_estados(automata);
+            for (int e = 0; e < MAX_ESTADOS; e++) {
+                totales[e] += automata->contadores[e];
+            }
+        }
+    }
+}
+
+// Función para agregar los totales del paso actual a la serie de tiempo
+void registrar_serie(MatrizAutomatas *matriz, long long totales[MAX_ESTADOS]) {
+    SerieTiempo *serie = matriz->serie;
+    if (serie->cantidad == serie->capacidad) {
+        serie->capacidad = serie->capacidad ? serie->capacidad * 2 : 256;
+        serie->pasos = (int*)realloc(serie->pasos, serie->capacidad * sizeof(int));
+        serie->totales = (long long (*)[MAX_ESTADOS])realloc(serie->totales, serie->capacidad * sizeof(*serie->totales));
+        serie->grupos = (long long*)realloc(serie->grupos, serie->capacidad * sizeof(long long));
+        serie->mayor_grupo = (long long*)realloc(serie->mayor_grupo, serie->capacidad * sizeof(long long));
+    }
+    serie->pasos[serie->cantidad] = matriz->paso_actual;
+    memcpy(serie->totales[serie->cantidad], totales, MAX_ESTADOS * sizeof(long long));
+    serie->grupos[serie->cantidad] = serie->mayor_grupo[serie->cantidad] = -1;  // -1: grupos no registrados
+    if (serie->con_grupos) {
+        ResumenGrupos resumen;
+        contar_grupos(matriz, &resumen, 0);
+        serie->grupos[serie->cantidad] = resumen.grupos;
+        serie->mayor_grupo[serie->cantidad] = resumen.mayor;
+    }
+    serie->cantidad++;
+}
+
+// Función para liberar la serie de tiempo
+void liberar_serie(SerieTiempo *serie) {
+    if (!serie) return;
+    free(serie->pasos);
+    free(serie->totales);
+    free(serie->grupos);
+    free(serie->mayor_grupo);
+    free(serie);
+}
+
+
+// Funciones de los grupos de células contagiosas
+// Cada autómata se recorre por filas empaquetadas (un bit por célula), así que las zonas sin contagiosos se saltan
+// de a 64 células. Los tramos consecutivos de cada fila (corridas) se unen con union-find con los de la fila
+// anterior y forman los componentes del autómata; a través de los bordes entre autómatas con el mismo ID se guardan
+// los pares de componentes que se tocan (enlaces), con las mismas tablas que usa obtener_vecinos.
+// Todo esto se conserva entre conteos: los motores marcan las filas en que alguna célula entró o salió del estado
+// contagioso, y solo esas filas (en paralelo entre autómatas) y los enlaces de esos autómatas se vuelven a armar.
+
+// Función para buscar desde la columna `desde` la primera célula de la fila cuyo bit vale `valor` (N si no hay)
+int buscar_bit(const unsigned long long *fila, int N, int desde, int valor) {
+    while (desde < N) {
+        int palabra = desde >> 6;
+        unsigned long long bits = valor ? fila[palabra] : ~fila[palabra];
+        bits &= ~0ULL << (desde & 63);
+        if (bits) {
+            int posicion = (palabra << 6) + __builtin_ctzll(bits);
+            return posicion < N ? posicion : N;
+        }
+        desde = (palabra + 1) << 6;
+    }
+    return N;
+}
+
+// Función para empaquetar una fila de estados en bits: 1 en cada célula igual a `contagioso`
+// Compara ocho células por vez dentro de una palabra de 64 bits (un byte por célula) y junta el bit alto de cada
+// byte igual con una multiplicación; las células que no completan una palabra van de a una.
+static void empaquetar_fila(const unsigned char *fila, int N, unsigned char contagioso, unsigned long long *bits) {
+    int j = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    const unsigned long long bajos = 0x7f7f7f7f7f7f7f7fULL;
+    const unsigned long long patron = 0x0101010101010101ULL * contagioso;
+    for (; j + 8 <= N; j += 8) {
+        unsigned long long celdas;
+        memcpy(&celdas, fila + j, 8);
+        unsigned long long diferencia = celdas ^ patron;
+        unsigned long long iguales = ~(((diferencia & bajos) + bajos) | diferencia | bajos);  // Bit alto de cada byte en 0
+        bits[j >> 6] |= (((iguales >> 7) * 0x0102040810204080ULL) >> 56) << (j & 63);
+    }
+#endif
+    for (; j < N; j++) {
+        bits[j >> 6] |= (unsigned long long)(fila[j] == contagioso) << (j & 63);
+    }
+}
+
+// Función para encontrar la raíz de una corrida dentro del union-find local de un autómata
+static int raiz_local(int *padre, int corrida) {
+    while (padre[corrida] != corrida) {
+        padre[corrida] = padre[padre[corrida]];
+        corrida = padre[corrida];
+    }
+    return corrida;
+}
+
+// Función para asegurar espacio para `cantidad` corridas en el autómata
+static void reservar_corridas(CorridasAutomata *corridas, int cantidad) {
+    if (cantidad <= corridas->capacidad) return;
+    while (corridas->capacidad < cantidad) corridas->capacidad = corridas->capacidad ? corridas->capacidad * 2 : 64;
+    corridas->inicio = (int*)realloc(corridas->inicio, corridas->capacidad * sizeof(int));
+    corridas->fin = (int*)realloc(corridas->fin, corridas->capacidad * sizeof(int));
+}
+
+// Función para armar las corridas de células en el estado `contagioso` de un autómata, unir las que se tocan y
+// numerar sus componentes
+// Con las corridas al día solo se recorren las filas marcadas en filas_cambiadas y las demás se copian del conteo
+// anterior; la unión y los componentes se rehacen con todas las corridas, que son muchas menos que las células.
+void etiquetar_corridas(CorridasAutomata *corridas, unsigned char contagioso) {
+    Automata *automata = corridas->automata;
+    int N = automata->N;
+    int palabras = (N + 63) / 64;
+    int todo = !automata->corridas_al_dia || corridas->N != N;
+    if (todo) {
+        automata->filas_cambiadas = (unsigned long long*)realloc(automata->filas_cambiadas, palabras * sizeof(unsigned long long));
+    }
+
+    // Las corridas del conteo anterior pasan a ser la referencia de las filas que no cambiaron
+    int *inicio_anterior = corridas->inicio, *fin_anterior = corridas->fin, *primera_anterior = corridas->primera;
+    int capacidad_anterior = corridas->capacidad;
+    corridas->inicio = corridas->inicio_anterior;
+    corridas->fin = corridas->fin_anterior;
+    corridas->primera = (int*)realloc(corridas->primera_anterior, (N + 1) * sizeof(int));
+    corridas->capacidad = corridas->capacidad_anterior;
+    corridas->inicio_anterior = inicio_anterior;
+    corridas->fin_anterior = fin_anterior;
+    corridas->primera_anterior = primera_anterior;
+    corridas->capacidad_anterior = capacidad_anterior;
+
+    // Fila empaquetada: un bit por célula
+    unsigned long long *bits = (unsigned long long*)malloc(palabras * sizeof(unsigned long long));
+    corridas->cantidad = 0;
+    for (int i = 0; i < N; i++) {
+        corridas->primera[i] = corridas->cantidad;
+        if (!todo && !((automata->filas_cambiadas[i >> 6] >> (i & 63)) & 1)) {
+            int desde = primera_anterior[i], cuantas = primera_anterior[i + 1] - desde;
+            if (cuantas == 0) continue;
+            reservar_corridas(corridas, corridas->cantidad + cuantas);
+            memcpy(corridas->inicio + corridas->cantidad, inicio_anterior + desde, cuantas * sizeof(int));
+            memcpy(corridas->fin + corridas->cantidad, fin_anterior + desde, cuantas * sizeof(int));
+            corridas->cantidad += cuantas;
+            continue;
+        }
+        memset(bits, 0, palabras * sizeof(unsigned long long));
+        empaquetar_fila(&ESTADO(automata, i, 0), N, contagioso, bits);
+        for (int j = buscar_bit(bits, N, 0, 1); j < N; ) {
+            int fin = buscar_bit(bits, N, j, 0) - 1;
+            reservar_corridas(corridas, corridas->cantidad + 1);
+            corridas->inicio[corridas->cantidad] = j;
+            corridas->fin[corridas->cantidad] = fin;
+            corridas->cantidad++;
+            j = buscar_bit(bits, N, fin + 1, 1);
+        }
+    }
+    corridas->primera[N] = corridas->cantidad;
+    free(bits);
+    memset(automata->filas_cambiadas, 0, palabras * sizeof(unsigned long long));
+    automata->corridas_al_dia = 1;
+    corridas->N = N;
+
+    int cantidad = corridas->cantidad;
+    if (cantidad > corridas->capacidad_union) {
+        corridas->capacidad_union = corridas->capacidad;
+        corridas->padre = (int*)realloc(corridas->padre, corridas->capacidad_union * sizeof(int));
+        corridas->componente = (int*)realloc(corridas->componente, corridas->capacidad_union * sizeof(int));
+        corridas->tamano_componente = (long long*)realloc(corridas->tamano_componente, corridas->capacidad_union * sizeof(long long));
+    }
+
+    // Dos corridas de filas consecutivas se tocan (también en diagonal) si sus columnas se superponen o son contiguas
+    int *inicio = corridas->inicio, *fin = corridas->fin, *padre = corridas->padre;
+    for (int r = 0; r < cantidad; r++) padre[r] = r;
+    for (int i = 1; i < N; i++) {
+        int r = corridas->primera[i], q = corridas->primera[i - 1];
+        while (r < corridas->primera[i + 1] && q < corridas->primera[i]) {
+            if (fin[q] < inicio[r] - 1) { q++; continue; }
+            if (fin[r] < inicio[q] - 1) { r++; continue; }
+            int a = raiz_local(padre, r), b = raiz_local(padre, q);
+            if (a != b) padre[a > b ? a : b] = a > b ? b : a;
+            if (fin[q] < fin[r]) q++; else r++;
+        }
+    }
+
+    // Componentes: la raíz de cada grupo de corridas es la de menor índice, así que se numera antes que el resto
+    corridas->componentes = 0;
+    for (int r = 0; r < cantidad; r++) {
+        int raiz = raiz_local(padre, r);
+        if (raiz == r) corridas->tamano_componente[corridas->componentes++] = 0;
+        corridas->componente[r] = raiz == r ? corridas->componentes - 1 : corridas->componente[raiz];
+        corridas->tamano_componente[corridas->componente[r]] += fin[r] - inicio[r] + 1;
+    }
+}
+
+// Función para etiquetar autómatas pendientes hasta que no quede ninguno sin tomar
+static void etiquetar_pendientes(TrabajoGrupos *trabajo) {
+    int k;
+    while ((k = __atomic_fetch_add(&trabajo->siguiente, 1, __ATOMIC_RELAXED)) < trabajo->cantidad) {
+        etiquetar_corridas(&trabajo->corridas[trabajo->pendientes[k]], trabajo->contagioso);
+    }
+}
+
+// Función que ejecuta cada hilo: espera una ronda, etiqueta pendientes y avisa que terminó
+void* etiquetar_en_hilo(void *argumento) {
+    HilosGrupos *hilos = (HilosGrupos*)argumento;
+    int ronda = 0;
+    pthread_mutex_lock(&hilos->mutex);
+    for (;;) {
+        while (!hilos->salir && hilos->ronda == ronda) pthread_cond_wait(&hilos->inicio, &hilos->mutex);
+        if (hilos->salir) break;
+        ronda = hilos->ronda;
+        pthread_mutex_unlock(&hilos->mutex);
+        etiquetar_pendientes(&hilos->trabajo);
+        pthread_mutex_lock(&hilos->mutex);
+        if (--hilos->trabajando == 0) pthread_cond_signal(&hilos->fin);
+    }
+    pthread_mutex_unlock(&hilos->mutex);
+    return NULL;
+}
+
+// Función para crear los hilos de etiquetado (si no se puede crear alguno, se trabaja con los que haya)
+HilosGrupos* crear_hilos_grupos(int cantidad_hilos) {
+    HilosGrupos *hilos = (HilosGrupos*)calloc(1, sizeof(HilosGrupos));
+    pthread_mutex_init(&hilos->mutex, NULL);
+    pthread_cond_init(&hilos->inicio, NULL);
+    pthread_cond_init(&hilos->fin, NULL);
+    hilos->pid = getpid();
+    hilos->hilos = (pthread_t*)malloc((cantidad_hilos > 0 ? cantidad_hilos : 1) * sizeof(pthread_t));
+    for (int h = 0; h < cantidad_hilos; h++) {
+        if (pthread_create(&hilos->hilos[hilos->cantidad_hilos], NULL, etiquetar_en_hilo, hilos) == 0) hilos->cantidad_hilos++;
+    }
+    return hilos;
+}
+
+// Función para terminar los hilos de etiquetado y liberarlos
+void liberar_hilos_grupos(HilosGrupos *hilos) {
+    if (!hilos) return;
+    if (hilos->pid == getpid()) {
+        pthread_mutex_lock(&hilos->mutex);
+        hilos->salir = 1;
+        pthread_cond_broadcast(&hilos->inicio);
+        pthread_mutex_unlock(&hilos->mutex);
+        for (int h = 0; h < hilos->cantidad_hilos; h++) pthread_join(hilos->hilos[h], NULL);
+        pthread_mutex_destroy(&hilos->mutex);
+        pthread_cond_destroy(&hilos->inicio);
+        pthread_cond_destroy(&hilos->fin);
+    }
+    free(hilos->hilos);
+    free(hilos);
+}
+
+// Función para etiquetar los autómatas pendientes entre los hilos y el hilo actual
+// Con un solo pendiente, sin hilos o desde un hijo de fork (que no hereda los hilos) se etiqueta en el hilo actual.
+void etiquetar_con_hilos(HilosGrupos *hilos, TrabajoGrupos trabajo) {
+    if (trabajo.cantidad < 2 || hilos->cantidad_hilos == 0 || hilos->pid != getpid()) {
+        etiquetar_pendientes(&trabajo);
+        return;
+    }
+    pthread_mutex_lock(&hilos->mutex);
+    hilos->trabajo = trabajo;
+    hilos->trabajando = hilos->cantidad_hilos;
+    hilos->ronda++;
+    pthread_cond_broadcast(&hilos->inicio);
+    pthread_mutex_unlock(&hilos->mutex);
+
+    etiquetar_pendientes(&hilos->trabajo);
+
+    pthread_mutex_lock(&hilos->mutex);
+    while (hilos->trabajando > 0) pthread_cond_wait(&hilos->fin, &hilos->mutex);
+    pthread_mutex_unlock(&hilos->mutex);
+}
+
+// Función para liberar el conteo de grupos guardado en la matriz
+void liberar_conteo_grupos(MatrizAutomatas *matriz) {
+    ConteoGrupos *grupos = matriz->grupos;
+    if (!grupos) return;
+    for (int k = 0; k < matriz->filas * matriz->columnas; k++) {
+        CorridasAutomata *corridas = &grupos->corridas[k];
+        free(corridas->inicio);
+        free(corridas->fin);
+        free(corridas->primera);
+        free(corridas->inicio_anterior);
+        free(corridas->fin_anterior);
+        free(corridas->primera_anterior);
+        free(corridas->padre);
+        free(corridas->componente);
+        free(corridas->tamano_componente);
+        for (int d = 0; d < 8; d++) free(corridas->enlaces[d]);
+    }
+    free(grupos->corridas);
+    free(grupos->base);
+    free(grupos->padre);
+    free(grupos->tamano);
+    free(grupos);
+    matriz->grupos = NULL;
+}
+
+// Función para encontrar la corrida de la fila que contiene la columna indicada (-1 si la célula no es contagiosa)
+int corrida_en(const CorridasAutomata *corridas, int fila, int columna) {
+    int bajo = corridas->primera[fila], alto = corridas->primera[fila + 1] - 1;
+    while (bajo <= alto) {
+        int medio = (bajo + alto) / 2;
+        if (corridas->fin[medio] < columna) bajo = medio + 1;
+        else if (corridas->inicio[medio] > columna) alto = medio - 1;
+        else return medio;
+    }
+    return -1;
+}
+
+// Función para encontrar la raíz de una corrida en el union-find de toda la matriz
+long long raiz_grupo(long long *padre, long long corrida) {
+    while (padre[corrida] != corrida) {
+        padre[corrida] = padre[padre[corrida]];
+        corrida = padre[corrida];
+    }
+    return corrida;
+}
+
+// Función para unir los grupos de dos corridas de la matriz
+void unir_grupos(long long *padre, long long a, long long b) {
+    a = raiz_grupo(padre, a);
+    b = raiz_grupo(padre, b);
+    if (a != b) padre[a > b ? a : b] = a > b ? b : a;
+}
+
+// Función para agregar un enlace entre un componente del autómata y uno de su vecino en la dirección d
+// Se descarta el enlace si repite el anterior, como pasa con las corridas de un mismo componente a lo largo del borde
+static void agregar_enlace(CorridasAutomata *corridas, int d, int propio, int del_vecino) {
+    int cantidad = corridas->cantidad_enlaces[d];
+    int *enlaces = corridas->enlaces[d];
+    if (cantidad > 0 && enlaces[2 * cantidad - 2] == propio && enlaces[2 * cantidad - 1] == del_vecino) return;
+    if (cantidad == corridas->capacidad_enlaces[d]) {
+        corridas->capacidad_enlaces[d] = cantidad ? cantidad * 2 : 16;
+        enlaces = corridas->enlaces[d] = (int*)realloc(enlaces, 2 * corridas->capacidad_enlaces[d] * sizeof(int));
+    }
+    enlaces[2 * cantidad] = propio;
+    enlaces[2 * cantidad + 1] = del_vecino;
+    corridas->cantidad_enlaces[d]++;
+}
+
+// Función para enlazar las corridas de la última fila de `arriba` con las de la primera fila de `abajo` que tocan
+// Las células vecinas de un tramo [a,b] son las del intervalo [desde[a], hasta[b]] del otro lado, que solo avanza.
+void enlazar_borde_abajo(CorridasAutomata *arriba, CorridasAutomata *abajo) {
+    Automata *automata = arriba->automata;
+    int N = automata->N;
+    int q = 0, fin_abajo = abajo->primera[1];
+    for (int r = arriba->primera[N - 1]; r < arriba->primera[N]; r++) {
+        int desde = automata->desde[BORDE_ABAJO][arriba->inicio[r]];
+        int hasta = automata->hasta[BORDE_ABAJO][arriba->fin[r]];
+        while (q < fin_abajo && abajo->fin[q] < desde) q++;
+        for (int t = q; t < fin_abajo && abajo->inicio[t] <= hasta; t++) {
+            agregar_enlace(arriba, BORDE_ABAJO, arriba->componente[r], abajo->componente[t]);
+        }
+    }
+}
+
+// Función para enlazar las células de la última columna de `izquierda` con las de la primera columna de `derecha`
+void enlazar_borde_derecha(CorridasAutomata *izquierda, CorridasAutomata *derecha) {
+    Automata *automata = izquierda->automata;
+    int N = automata->N;
+    for (int x = 0; x < N; x++) {
+        int r = izquierda->primera[x + 1] - 1;
+        if (r < izquierda->primera[x] || izquierda->fin[r] != N - 1) continue;
+        for (int q = automata->desde[BORDE_DERECHA][x]; q <= automata->hasta[BORDE_DERECHA][x]; q++) {
+            int t = derecha->primera[q];
+            if (t < derecha->primera[q + 1] && derecha->inicio[t] == 0) {
+                agregar_enlace(izquierda, BORDE_DERECHA, izquierda->componente[r], derecha->componente[t]);
+            }
+        }
+    }
+}
+
+// Direcciones en que cada autómata guarda sus enlaces: abajo, derecha y las dos esquinas de abajo alcanzan,
+// porque la vecindad entre autómatas con el mismo ID es simétrica
+static const int direcciones_enlaces[4] = {BORDE_ABAJO, BORDE_DERECHA, ESQUINA_ABAJO_IZQUIERDA, ESQUINA_ABAJO_DERECHA};
+
+// Función para volver a calcular los enlaces caducados del autómata k: los de las direcciones en que cambió el
+// vecino (por un cambio de ID) o en que alguno de los dos autómatas se volvió a armar en este conteo
+void enlazar_vecinos(MatrizAutomatas *matriz, CorridasAutomata *corridas, int k) {
+    CorridasAutomata *propias = &corridas[k];
+    Automata *automata = propias->automata;
+    int N = automata->N;
+    for (int e = 0; e < 4; e++) {
+        int d = direcciones_enlaces[e];
+        Automata *vecino = automata->adyacentes[d];
+        CorridasAutomata *otras = vecino ? &corridas[vecino->indice_x * matriz->columnas + vecino->indice_y] : NULL;
+        if (vecino == propias->vecino_enlaces[d] && !propias->rearmada && !(otras && otras->rearmada)) continue;
+
+        propias->vecino_enlaces[d] = vecino;
+        propias->cantidad_enlaces[d] = 0;
+        if (!otras || propias->cantidad == 0 || otras->cantidad == 0) continue;
+        if (d == BORDE_ABAJO) {
+            enlazar_borde_abajo(propias, otras);
+        } else if (d == BORDE_DERECHA) {
+            enlazar_borde_derecha(propias, otras);
+        } else {
+            int r = corrida_en(propias, N - 1, d == ESQUINA_ABAJO_IZQUIERDA ? 0 : N - 1);
+            int t = corrida_en(otras, 0, d == ESQUINA_ABAJO_IZQUIERDA ? vecino->N - 1 : 0);
+            if (r >= 0 && t >= 0) agregar_enlace(propias, d, propias->componente[r], otras->componente[t]);
+        }
+    }
+}
+
+// Función para saber si quedó marcada alguna fila del autómata desde el último conteo de grupos
+static int hay_filas_cambiadas(const Automata *automata) {
+    for (int p = 0; p < (automata->N + 63) / 64; p++) {
+        if (automata->filas_cambiadas[p]) return 1;
+    }
+    return 0;
+}
+
+// Función para contar los grupos de células en el estado contagioso del modelo
+// Con con_tamanos guarda además el tamaño de cada grupo en resumen->tamanos.
+// El conteo se guarda en la matriz entre pasos: solo se vuelven a armar las filas marcadas de los autómatas que
+// cambiaron y los enlaces de sus bordes, y si nada cambió se devuelve el resultado anterior. En cada conteo se
+// unen de nuevo solo los componentes de los autómatas a través de sus enlaces, no sus corridas ni sus células.
+void contar_grupos(MatrizAutomatas *matriz, ResumenGrupos *resumen, int con_tamanos) {
+    memset(resumen, 0, sizeof(ResumenGrupos));
+    int contagioso = matriz->modelo.contagioso;
+    if (contagioso < 0) return;
+    if (!matriz->bordes_al_dia) calcular_bordes(matriz);
+
+    int cantidad = matriz->filas * matriz->columnas;
+    if (!matriz->grupos) {
+        ConteoGrupos *grupos = (ConteoGrupos*)calloc(1, sizeof(ConteoGrupos));
+        grupos->corridas = (CorridasAutomata*)calloc(cantidad, sizeof(CorridasAutomata));
+        for (int k = 0; k < cantidad; k++) {
+            grupos->corridas[k].automata = matriz->matriz[k / matriz->columnas][k % matriz->columnas];
+        }
+        grupos->contagioso = -1;
+        grupos->base = (long long*)malloc((cantidad + 1) * sizeof(long long));
+        matriz->grupos = grupos;
+    }
+    ConteoGrupos *grupos = matriz->grupos;
+    CorridasAutomata *corridas = grupos->corridas;
+
+    // Autómatas a volver a armar (todos si cambió el estado contagioso) y enlaces cuyo vecino cambió
+    int *pendientes = (int*)malloc(cantidad * sizeof(int));
+    int cantidad_pendientes = 0, cambio_vecino = 0;
+    for (int k = 0; k < cantidad; k++) {
+        Automata *automata = corridas[k].automata;
+        if (grupos->contagioso != contagioso) automata->corridas_al_dia = 0;
+        corridas[k].rearmada = !automata->corridas_al_dia || hay_filas_cambiadas(automata);
+        if (corridas[k].rearmada) pendientes[cantidad_pendientes++] = k;
+        for (int e = 0; e < 4; e++) {
+            int d = direcciones_enlaces[e];
+            if (automata->adyacentes[d] != corridas[k].vecino_enlaces[d]) cambio_vecino = 1;
+        }
+    }
+    if (cantidad_pendientes == 0 && !cambio_vecino && !con_tamanos) {
+        free(pendientes);
+        *resumen = grupos->resultado;
+        return;
+    }
+
+    // Etiquetado de los autómatas que cambiaron, repartido entre los procesadores disponibles
+    if (!matriz->hilos_grupos) {
+        long procesadores = sysconf(_SC_NPROCESSORS_ONLN);
+        int hilos = procesadores < 1 ? 1 : (procesadores < cantidad ? (int)procesadores : cantidad);
+        matriz->hilos_grupos = crear_hilos_grupos(hilos - 1);
+    }
+    TrabajoGrupos trabajo = {corridas, pendientes, cantidad_pendientes, 0, (unsigned char)contagioso};
+    etiquetar_con_hilos(matriz->hilos_grupos, trabajo);
+    grupos->contagioso = contagioso;
+    free(pendientes);
+    for (int k = 0; k < cantidad; k++) enlazar_vecinos(matriz, corridas, k);
+
+    // Union-find de toda la matriz, con los componentes de cada autómata a partir de su base
+    long long *base = grupos->base;
+    base[0] = 0;
+    for (int k = 0; k < cantidad; k++) base[k + 1] = base[k] + corridas[k].componentes;
+    long long total = base[cantidad];
+    if (total > grupos->capacidad) {
+        grupos->capacidad = total;
+        grupos->padre = (long long*)realloc(grupos->padre, total * sizeof(long long));
+        grupos->tamano = (long long*)realloc(grupos->tamano, total * sizeof(long long));
+    }
+    long long *padre = grupos->padre, *tamano = grupos->tamano;
+    for (long long c = 0; c < total; c++) {
+        padre[c] = c;
+        tamano[c] = 0;
+    }
+    for (int k = 0; k < cantidad; k++) {
+        for (int e = 0; e < 4; e++) {
+            int d = direcciones_enlaces[e];
+            Automata *vecino = corridas[k].vecino_enlaces[d];
+            if (!corridas[k].cantidad_enlaces[d]) continue;
+            long long base_vecino = base[vecino->indice_x * matriz->columnas + vecino->indice_y];
+            const int *enlaces = corridas[k].enlaces[d];
+            for (int l = 0; l < corridas[k].cantidad_enlaces[d]; l++) {
+                unir_grupos(padre, base[k] + enlaces[2 * l], base_vecino + enlaces[2 * l + 1]);
+            }
+        }
+    }
+
+    // Tamaño de cada grupo, acumulado en su raíz
+    ResumenGrupos *resultado = &grupos->resultado;
+    memset(resultado, 0, sizeof(ResumenGrupos));
+    for (int k = 0; k < cantidad; k++) {
+        for (int c = 0; c < corridas[k].componentes; c++) {
+            tamano[raiz_grupo(padre, base[k] + c)] += corridas[k].tamano_componente[c];
+            resultado->celulas += corridas[k].tamano_componente[c];
+        }
+    }
+    if (con_tamanos) resumen->tamanos = (long long*)malloc((total ? total : 1) * sizeof(long long));
+    for (long long c = 0; c < total; c++) {
+        if (tamano[c] == 0) continue;
+        if (con_tamanos) resumen->tamanos[resultado->grupos] = tamano[c];
+        resultado->grupos++;
+        if (tamano[c] > resultado->mayor) resultado->mayor = tamano[c];
+    }
+    long long *tamanos = resumen->tamanos;
+    *resumen = *resultado;
+    resumen->tamanos = tamanos;
+}
+
+
+// Funciones del barrido de parámetros
+// Cada combinación corre en un proceso hijo creado con fork después de armar la matriz, así que todas parten del
+// mismo estado inicial compartido copia-en-escritura: ningún hijo vuelve a armar el mundo y solo se copian las
+// páginas que cada uno modifica. Cada hijo escribe su resumen en su propia tubería.
+
+// Función para simular una combinación dentro del proceso hijo y escribir su resumen en la tubería (no retorna)
+void correr_combinacion(MatrizAutomatas *matriz, const Parametros *parametros, int pasos, unsigned int semilla, int fd) {
+    ResultadoBarrido resultado;
+    memset(&resultado, 0, sizeof(resultado));
+    srand(semilla);
+
+    // Un mundo respaldado se vuelve a proyectar en privado, para que la corrida no escriba el archivo compartido
+    if (matriz->respaldo && mmap(matriz->respaldo, matriz->tam_respaldo, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_FIXED, matriz->fd_respaldo, 0) == MAP_FAILED) {
+        _exit(1);
+    }
+    matriz->parametros = *parametros;
+    matriz->modelo_al_dia = 0;
+    // El historial y la serie del padre quedan intactos; la corrida usa una serie propia para el máximo de contagiosos
+    matriz->historial = NULL;
+    matriz->serie = (SerieTiempo*)calloc(1, sizeof(SerieTiempo));
+
+    int contagioso = matriz->modelo.contagioso >= 0 ? matriz->modelo.contagioso : V;
+    contar_totales(matriz, resultado.totales);
+    resultado.max_infectados = matriz->modelo.contagioso >= 0 ? resultado.totales[contagioso] : 0;
+    resultado.paso_max_infectados = matriz->paso_actual;
+    if (pasos > 0) avanzar_simulacion(matriz, pasos);
+
+    SerieTiempo *serie = matriz->serie;
+    for (int p = 0; p < serie->cantidad && matriz->modelo.contagioso >= 0; p++) {
+        if (serie->totales[p][contagioso] > resultado.max_infectados) {
+            resultado.max_infectados = serie->totales[p][contagioso];
+            resultado.paso_max_infectados = serie->pasos[p];
+        }
+    }
+    if (serie->cantidad > 0) memcpy(resultado.totales, serie->totales[serie->cantidad - 1], sizeof(resultado.totales));
+    resultado.completado = 1;
+
+    // _exit evita vaciar los buffers de stdio heredados del padre
+    const unsigned char *datos = (const unsigned char*)&resultado;
+    size_t enviados = 0;
+    while (enviados < sizeof(resultado)) {
+        ssize_t n = write(fd, datos + enviados, sizeof(resultado) - enviados);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) _exit(1);
+        enviados += n;
+    }
+    _exit(0);
+}
+
+// Función para leer el resumen de una corrida; devuelve 0 si el hijo terminó sin enviarlo completo
+int leer_resultado(int fd, ResultadoBarrido *resultado) {
+    unsigned char *datos = (unsigned char*)resultado;
+    size_t leidos = 0;
+    while (leidos < sizeof(*resultado)) {
+        ssize_t n = read(fd, datos + leidos, sizeof(*resultado) - leidos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        leidos += n;
+    }
+    return 1;
+}
+
+// Función para correr todas las combinaciones manteniendo a lo sumo `procesos` hijos vivos a la vez
+// Devuelve la cantidad de corridas completadas; las que fallaron quedan con completado = 0
+int barrer_parametros(MatrizAutomatas *matriz, const Parametros *combinaciones, int cantidad, int pasos, int procesos, ResultadoBarrido *resultados) {
+    if (procesos < 1) procesos = 1;
+    struct pollfd *tuberias = (struct pollfd*)malloc(procesos * sizeof(struct pollfd));
+    pid_t *hijos = (pid_t*)malloc(procesos * sizeof(pid_t));
+    int *corridas = (int*)malloc(procesos * sizeof(int));
+    unsigned int semilla = (unsigned int)rand();
+    int lanzadas = 0, activas = 0, completadas = 0, lanzar = 1;
+
+    memset(resultados, 0, cantidad * sizeof(ResultadoBarrido));
+    while ((lanzar && lanzadas < cantidad) || activas > 0) {
+        while (lanzar && lanzadas < cantidad && activas < procesos) {
+            int tubo[2];
+            if (pipe(tubo) < 0) {
+                perror("Error al crear la tubería del barrido");
+                lanzar = 0;
+                break;
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("Error al crear el proceso del barrido");
+                close(tubo[0]);
+                close(tubo[1]);
+                lanzar = 0;
+                break;
+            }
+            if (pid == 0) {
+                close(tubo[0]);
+                for (int a = 0; a < activas; a++) close(tuberias[a].fd);
+                correr_combinacion(matriz, &combinaciones[lanzadas], pasos, semilla + lanzadas, tubo[1]);
+            }
+            close(tubo[1]);
+            tuberias[activas].fd = tubo[0];
+            tuberias[activas].events = POLLIN;
+            hijos[activas] = pid;
+            corridas[activas] = lanzadas;
+            activas++;
+            lanzadas++;
+        }
+        if (activas == 0) break;
+
+        for (int a = 0; a < activas; a++) tuberias[a].revents = 0;
+        if (poll(tuberias, activas, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("Error al esperar los procesos del barrido");
+            for (int a = 0; a < activas; a++) tuberias[a].revents = POLLIN;  // Leemos en orden, bloqueando
+        }
+
+        // Recogemos las corridas terminadas; el último hijo activo pasa a ocupar el lugar liberado
+        for (int a = 0; a < activas; a++) {
+            if (!tuberias[a].revents) continue;
+            if (leer_resultado(tuberias[a].fd, &resultados[corridas[a]])) completadas++;
+            else resultados[corridas[a]].completado = 0;
+            close(tuberias[a].fd);
+            waitpid(hijos[a], NULL, 0);
+            activas--;
+            tuberias[a] = tuberias[activas];
+            hijos[a] = hijos[activas];
+            corridas[a] = corridas[activas];
+            a--;
+        }
+    }
+
+    free(tuberias);
+    free(hijos);
+    free(corridas);
+    return completadas;
+}
+
+// Funciones de la API pública
+// Un ca_mundo es la misma MatrizAutomatas que usa el parser. La biblioteca no escribe en la salida estándar; solo
+// informa en stderr los errores del sistema (archivo de respaldo, procesos del barrido).
+
+// Función para crear un mundo en memoria
+ca_mundo* ca_crear(int filas, int columnas, int celdas) {
+    if (filas <= 0 || columnas <= 0 || celdas <= 0) return NULL;
+    return crear_matriz_automatas(filas, columnas, celdas);
+}
+
+// Función para crear un mundo con los planos de estados en un archivo proyectado en memoria
+ca_mundo* ca_crear_respaldado(int filas, int columnas, int celdas, const char *ruta, int paginas_grandes) {
+    if (filas <= 0 || columnas <= 0 || celdas <= 0) return NULL;
+    return crear_matriz_automatas_respaldada(filas, columnas, celdas, ruta, paginas_grandes);
+}
+
+void ca_destruir(ca_mundo *mundo) {
+    if (mundo) liberar_matriz_automatas(mundo);
+}
+
+int ca_filas(const ca_mundo *mundo) {
+    return mundo->filas;
+}
+
+int ca_columnas(const ca_mundo *mundo) {
+    return mundo->columnas;
+}
+
+
+int ca_paso(const ca_mundo *mundo) {
+    return mundo->paso_actual;
+}
+
+// Función para obtener el autómata (m,n) de un mundo, o NULL si no existe
+static Automata* automata_del_mundo(const ca_mundo *mundo, int m, int n) {
+    if (m < 0 || m >= mundo->filas || n < 0 || n >= mundo->columnas) return NULL;
+    return mundo->matriz[m][n];
+}
+
+int ca_establecer_id(ca_mundo *mundo, int m, int n, int id) {
+    if (!automata_del_mundo(mundo, m, n)) return -1;
+    cambiar_id(mundo, m, n, id);
+    return 0;
+}
+
+int ca_celdas(const ca_mundo *mundo, int m, int n) {
+    Automata *automata = automata_del_mundo(mundo, m, n);
+    return automata ? automata->N : -1;
+}
+
+int ca_establecer_celdas(ca_mundo *mundo, int m, int n, int celdas) {
+    if (!automata_del_mundo(mundo, m, n) || celdas <= 0) return -1;
+    if (!cambiar_tamano(mundo, m, n, celdas)) return -1;
+    reiniciar_historial(mundo);
+    return 0;
+}
+
+int ca_obtener_id(const ca_mundo *mundo, int m, int n) {
+    Automata *automata = automata_del_mundo(mundo, m, n);
+    return automata ? obtener_id(automata) : -1;
+}
+
+// Función para agregar un área con un estado, registrándola en el historial si está activo
+int ca_agregar_area(ca_mundo *mundo, int m, int n, int estado, int inicio_fila, int inicio_columna, int filas, int columnas) {
+    Automata *automata = automata_del_mundo(mundo, m, n);
+    if (!automata || estado < 0 || estado >= mundo->modelo.cantidad_estados) return -1;
+    agregar_area_matriz(mundo, m, n, (Estado)estado, inicio_fila, inicio_columna, filas, columnas);
+    return 0;
+}
+
+void ca_establecer_parametros(ca_mundo *mundo, const ca_parametros *parametros) {
+    mundo->parametros = *parametros;
+    mundo->modelo_al_dia = 0;
+}
+
+void ca_obtener_parametros(const ca_mundo *mundo, ca_parametros *parametros) {
+    *parametros = mundo->parametros;
+}
+
+void ca_usar_motor_eventos(ca_mundo *mundo, int activar) {
+    mundo->motor = activar ? MOTOR_EVENTOS : MOTOR_CUADRICULA;
+}
+
+int ca_definir_modelo(ca_mundo *mundo, const char *letras, const ca_transicion *transiciones, int cantidad) {
+    if (!letras || cantidad < 0) return CA_MODELO_SIN_ESTADOS;
+    return definir_modelo(mundo, letras, transiciones, cantidad);
+}
+
+int ca_cantidad_estados(const ca_mundo *mundo) {
+    return mundo->modelo.cantidad_estados;
+}
+
+char ca_letra_estado(const ca_mundo *mundo, int estado) {
+    if (estado < 0 || estado >= mundo->modelo.cantidad_estados) return 0;
+    return mundo->modelo.letras[estado];
+}
+
+void ca_avanzar(ca_mundo *mundo, int pasos) {
+    if (pasos > 0) avanzar_simulacion(mundo, pasos);
+}
+
+int ca_contadores(ca_mundo *mundo, int m, int n, long long contadores[5]) {
+    Automata *automata = automata_del_mundo(mundo, m, n);
+    if (!automata) return -1;
+    contar_estados(automata);
+    memcpy(contadores, automata->contadores, 5 * sizeof(long long));
+    return 0;
+}
+
+void ca_totales(ca_mundo *mundo, long long totales[5]) {
+    long long todos[MAX_ESTADOS];
+    contar_totales(mundo, todos);
+    memcpy(totales, todos, 5 * sizeof(long long));
+}
+
+int ca_contadores_modelo(ca_mundo *mundo, int m, int n, long long *contadores) {
+    Automata *automata = automata_del_mundo(mundo, m, n);
+    if (!automata) return -1;
+    contar_estados(automata);
+    memcpy(contadores, automata->contadores, mundo->modelo.cantidad_estados * sizeof(long long));
+    return 0;
+}
+
+void ca_totales_modelo(ca_mundo *mundo, long long *totales) {
+    long long todos[MAX_ESTADOS];
+    contar_totales(mundo, todos);
+    memcpy(totales, todos, mundo->modelo.cantidad_estados * sizeof(long long));
+}
+
+long long ca_grupos(ca_mundo *mundo, long long *mayor) {
+    ResumenGrupos resumen;
+    contar_grupos(mundo, &resumen, 0);
+    if (mayor) *mayor = resumen.mayor;
+    return resumen.grupos;
+}
+
+int ca_barrer(ca_mundo *mundo, const ca_parametros *combinaciones, int cantidad, int pasos, int procesos, ca_resultado *resultados) {
+    if (cantidad <= 0) return 0;
+    return barrer_parametros(mundo, combinaciones, cantidad, pasos, procesos, resultados);
+}
+
+const unsigned char* ca_plano(const ca_mundo *mundo, int m, int n) {
+    Automata *automata = automata_del_mundo(mundo, m, n);
+    return automata ? automata->estados : NULL;
+}
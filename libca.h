@@ -0,0 +1,117 @@
+#ifndef LIBCA_H
+#define LIBCA_H
+
+// API pública de libca: simulación SEIRS sobre una matriz de autómatas celulares
+// Las funciones que reciben (m,n) devuelven -1 si el autómata no existe y 0 si todo salió bien.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Funciones exportadas por libca.so; la biblioteca se compila con -fvisibility=hidden y el resto queda interno
+#if defined(__GNUC__)
+#define CA_API __attribute__((visibility("default")))
+#else
+#define CA_API
+#endif
+
+// Mundo simulado: una matriz de autómatas con sus parámetros, motor, historial y serie de tiempo
+typedef struct ca_mundo ca_mundo;
+
+// Estados de una célula en el modelo SEIRS por defecto, con los mismos valores que se guardan en los planos
+// Un modelo definido con ca_definir_modelo numera sus estados desde 1 en el orden de sus letras; 0 es siempre V (vacío).
+enum {CA_V, CA_S, CA_E, CA_I, CA_R};
+
+#define CA_MAX_ESTADOS 16  // V más hasta 15 estados con letra
+
+// Probabilidades de transición, compartidas por todas las células del mundo
+typedef struct {
+    float prob_infeccion;
+    float prob_exposicion;
+    float prob_recuperacion;
+    float prob_mortalidad;
+    float prob_perdida_inmunidad;
+} ca_parametros;
+
+// Transición de un modelo compartimental, con los estados indicados por su letra ('V' es el estado vacío)
+// Si un estado tiene varias salidas, cada una ocupa su propio tramo de probabilidad; si suman más de 1 se escalan.
+typedef struct {
+    char origen;
+    char destino;
+    char vecino;     // Estado de los vecinos que la provoca (0 si es espontánea); todas deben usar el mismo
+    int por_vecino;  // 0: la tasa se aplica si hay algún vecino; 1: cada vecino contagia por separado
+    int parametro;   // -1 para usar tasa; 0..4 para tomar infección, exposición, recuperación, mortalidad o inmunidad
+    float tasa;
+} ca_transicion;
+
+// Resultados de ca_definir_modelo
+enum {CA_MODELO_VALIDO, CA_MODELO_SIN_ESTADOS, CA_MODELO_DEMASIADOS_ESTADOS, CA_MODELO_LETRA_INVALIDA,
+      CA_MODELO_ESTADO_DESCONOCIDO, CA_MODELO_TASA_INVALIDA, CA_MODELO_VARIOS_CONTAGIOSOS, CA_MODELO_ESTADOS_EN_USO};
+
+// Resumen de una corrida de un barrido de parámetros
+typedef struct {
+    long long totales[CA_MAX_ESTADOS];  // Totales por estado al terminar la corrida
+    long long max_infectados;   // Máximo de células en el estado contagioso del modelo (I en SEIRS) durante la corrida
+    int paso_max_infectados;
+    int completado;             // 0 si el proceso de la corrida falló
+} ca_resultado;
+
+// Creación y destrucción (NULL si no se pudo crear)
+// ca_crear_respaldado crea el archivo `ruta`; si ya existe solo lo usa cuando está vacío, nunca lo trunca.
+CA_API ca_mundo* ca_crear(int filas, int columnas, int celdas);
+CA_API ca_mundo* ca_crear_respaldado(int filas, int columnas, int celdas, const char *ruta, int paginas_grandes);
+CA_API void ca_destruir(ca_mundo *mundo);
+
+// Dimensiones y paso actual (cada autómata tiene su propia cantidad de células por lado)
+CA_API int ca_filas(const ca_mundo *mundo);
+CA_API int ca_columnas(const ca_mundo *mundo);
+CA_API int ca_celdas(const ca_mundo *mundo, int m, int n);
+CA_API int ca_paso(const ca_mundo *mundo);
+
+// Configuración del mundo
+CA_API int ca_establecer_id(ca_mundo *mundo, int m, int n, int id);
+CA_API int ca_obtener_id(const ca_mundo *mundo, int m, int n);
+// Cambia la resolución del autómata (m,n) remuestreando su contenido; el historial vuelve a empezar.
+// En un mundo respaldado falla si el nuevo plano no cabe en el espacio reservado al crearlo.
+CA_API int ca_establecer_celdas(ca_mundo *mundo, int m, int n, int celdas);
+CA_API int ca_agregar_area(ca_mundo *mundo, int m, int n, int estado, int inicio_fila, int inicio_columna, int filas, int columnas);
+CA_API void ca_establecer_parametros(ca_mundo *mundo, const ca_parametros *parametros);
+CA_API void ca_obtener_parametros(const ca_mundo *mundo, ca_parametros *parametros);
+CA_API void ca_usar_motor_eventos(ca_mundo *mundo, int activar);
+// Reemplaza el modelo SEIRS por otro con los estados de `letras` (en orden) y las transiciones dadas.
+// Devuelve CA_MODELO_VALIDO o el motivo del rechazo; un modelo rechazado deja el anterior intacto.
+// Las células conservan su letra: si alguna letra cambia de índice, las células, la serie y el historial pasan a
+// los nuevos índices (el historial vuelve a empezar en el paso actual). Con células en un estado cuya letra el
+// nuevo modelo no tiene, se rechaza con CA_MODELO_ESTADOS_EN_USO.
+CA_API int ca_definir_modelo(ca_mundo *mundo, const char *letras, const ca_transicion *transiciones, int cantidad);
+CA_API int ca_cantidad_estados(const ca_mundo *mundo);  // Incluye V
+CA_API char ca_letra_estado(const ca_mundo *mundo, int estado);
+
+// Simulación: avanza la cantidad de pasos indicada sin escribir nada en la salida
+CA_API void ca_avanzar(ca_mundo *mundo, int pasos);
+
+// Barrido: corre las combinaciones de parámetros desde el estado actual del mundo, en hasta `procesos` procesos
+// a la vez, sin modificar el mundo. Devuelve la cantidad de corridas completadas.
+CA_API int ca_barrer(ca_mundo *mundo, const ca_parametros *combinaciones, int cantidad, int pasos, int procesos, ca_resultado *resultados);
+
+// Contadores de los cinco primeros estados, indexados por CA_V..CA_R (en 0 los que el modelo no tenga)
+CA_API int ca_contadores(ca_mundo *mundo, int m, int n, long long contadores[5]);
+CA_API void ca_totales(ca_mundo *mundo, long long totales[5]);
+// Contadores de todos los estados del modelo (ca_cantidad_estados valores)
+CA_API int ca_contadores_modelo(ca_mundo *mundo, int m, int n, long long *contadores);
+CA_API void ca_totales_modelo(ca_mundo *mundo, long long *totales);
+
+// Grupos de células en el estado contagioso del modelo, conectadas por la vecindad de Moore (también entre
+// autómatas adyacentes con el mismo ID). Devuelve la cantidad y, si `mayor` no es NULL, el tamaño del mayor.
+// El mundo guarda el conteo: la llamada siguiente solo rehace las filas que cambiaron, y nada si no cambió ninguna.
+CA_API long long ca_grupos(ca_mundo *mundo, long long *mayor);
+
+// Plano de estados actual del autómata (m,n): ca_celdas(m,n)^2 bytes por filas, sin copiar (NULL si no existe)
+// El puntero deja de ser válido en la siguiente llamada que avance, reconstruya o destruya el mundo.
+CA_API const unsigned char* ca_plano(const ca_mundo *mundo, int m, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif